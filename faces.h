@@ -0,0 +1,7 @@
+// Face programs compiled from faces/ by fredrick-host facec. Do not edit;
+// change the .face sources and regenerate:
+//   ./fredrick-host facec > faces.h
+#pragma once
+
+// Ends at nullptr, so the table may be empty
+const uint8_t *const builtinFaces[] = {nullptr};
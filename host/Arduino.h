@@ -0,0 +1,56 @@
+// Minimal Arduino core for building the sketch on a desktop host.
+// Only what main.cpp uses is provided. Time is virtual: delay() advances
+// millis() instantly, so host runs are not tied to the wall clock.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+using std::min;
+using std::max;
+
+#define PI 3.1415926535897932384626433832795
+#define TWO_PI 6.283185307179586476925286766559
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+inline unsigned long hostMillis = 0;
+
+inline unsigned long millis() { return hostMillis; }
+inline unsigned long micros() { return hostMillis * 1000UL; }
+inline void delay(unsigned long ms) { hostMillis += ms; }
+
+// Stand-in for a CPU cycle counter: real nanoseconds, for profiling
+const uint32_t hostCyclesPerMicro = 1000;
+inline uint32_t hostCycleCount() {
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline void randomSeed(unsigned long seed) { srand(seed); }
+inline long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+inline long random(long howsmall, long howbig) {
+  return howsmall < howbig ? howsmall + random(howbig - howsmall) : howsmall;
+}
+inline int analogRead(uint8_t) { return 0; }
+
+// Serial prints to stdout
+struct HostSerial {
+  void begin(unsigned long) {}
+  void print(const char *s) { fputs(s, stdout); }
+  void print(char c) { putchar(c); }
+  void print(int v) { printf("%d", v); }
+  void print(unsigned int v) { printf("%u", v); }
+  void print(long v) { printf("%ld", v); }
+  void print(unsigned long v) { printf("%lu", v); }
+  void print(double v, int digits = 2) { printf("%.*f", digits, v); }
+  template <typename T> void println(T v) { print(v); putchar('\n'); }
+  void println(double v, int digits) { print(v, digits); putchar('\n'); }
+  void println() { putchar('\n'); }
+};
+inline HostSerial Serial;
@@ -0,0 +1,210 @@
+// In-memory U8g2 for host builds. Pixels land in a full frame buffer with
+// the same tile layout as U8g2's full-buffer (_F_) mode: 8-pixel-high pages,
+// one byte per column, LSB at the top. The panel size can be changed at run
+// time so benchmarks can compare resolutions from a single binary.
+#pragma once
+
+#include <vector>
+#include "Arduino.h"
+
+#define U8X8_PIN_NONE 255
+#define U8G2_R0 nullptr
+
+static const uint8_t u8g2_font_helvB12_tr[1] = {0};
+
+// Byte-level side of the display. Instead of a bus, the command/data stream
+// is decoded into a model of display RAM so host runs can check what a panel
+// would show: SSD1306/SH1107 pages (up to 128 columns by 16 pages, page or
+// horizontal addressing) or SSD1322 RAM (120 column addresses of 4 pixels by
+// 128 rows).
+struct u8x8_t {
+  enum Controller { SSD13XX, SSD1322 };
+  static const int ramRowBytes = 240;
+  static const int ramRows = 128;
+  static const int pageColumns = 128;
+  static const int pageCount = 16;
+
+  Controller controller = SSD13XX;
+  std::vector<uint8_t> ram = std::vector<uint8_t>(ramRowBytes * ramRows, 0);
+  std::vector<uint8_t> pageRam = std::vector<uint8_t>(pageColumns * pageCount, 0);
+  uint8_t command = 0;
+  int argCount = 0;
+  int argsWanted = 0;
+  uint8_t args[2] = {0, 0};
+  int columnStart = 0, columnEnd = 119, rowStart = 0, rowEnd = 127;
+  int writeByte = 0, writeRow = 0; // RAM write pointer
+  bool horizontal = false;          // SSD13xx addressing mode
+
+  unsigned long transfers = 0;
+  unsigned long bytesSent = 0;
+
+  // One bus transaction: a run of command bytes or of data bytes
+  void transaction(bool isData, const uint8_t *bytes, int count) {
+    transfers++;
+    bytesSent += count;
+    for (int i = 0; i < count; i++) {
+      if (controller == SSD1322) {
+        if (!isData) {
+          command_(bytes[i]);
+        } else if ((command == 0x15 || command == 0x75) && argCount < 2) {
+          arg(bytes[i]);
+        } else {
+          data(bytes[i]);
+        }
+      } else if (isData) {
+        pageData(bytes[i]);
+      } else {
+        pageCommand(bytes[i]);
+      }
+    }
+  }
+
+  // SSD1322
+  void command_(uint8_t c) {
+    command = c;
+    argCount = 0;
+    if (c == 0x5C) {
+      writeByte = columnStart * 2;
+      writeRow = rowStart;
+    }
+  }
+  void arg(uint8_t a) {
+    if (argCount < 2) args[argCount] = a;
+    if (++argCount == 2) {
+      if (command == 0x15) { columnStart = args[0]; columnEnd = args[1]; }
+      if (command == 0x75) { rowStart = args[0]; rowEnd = args[1]; }
+    }
+  }
+  void data(uint8_t d) {
+    if (command != 0x5C) return;
+    if (writeRow < ramRows && writeByte < ramRowBytes) ram[writeRow * ramRowBytes + writeByte] = d;
+    if (++writeByte > columnEnd * 2 + 1) {
+      writeByte = columnStart * 2;
+      if (++writeRow > rowEnd) writeRow = rowStart;
+    }
+  }
+
+  // SSD1306 and SH1107; arguments arrive as further command bytes. Here
+  // writeByte is the column and writeRow the page.
+  void pageCommand(uint8_t c) {
+    if (argsWanted > 0) {
+      args[argCount++ % 2] = c;
+      if (--argsWanted > 0) return;
+      if (command == 0x20) horizontal = args[0] == 0x00;
+      if (command == 0x21) { columnStart = writeByte = args[0]; columnEnd = args[1]; }
+      if (command == 0x22) { rowStart = writeRow = args[0]; rowEnd = args[1]; }
+      return;
+    }
+    command = c;
+    argCount = 0;
+    if (c == 0x20) {
+      argsWanted = 1;
+    } else if (c == 0x21 || c == 0x22) {
+      argsWanted = 2;
+    } else if (c >= 0xB0 && c <= 0xBF) {
+      writeRow = c & 0x0F;
+    } else if (c <= 0x0F) {
+      writeByte = (writeByte & 0xF0) | c;
+    } else if (c <= 0x1F) {
+      writeByte = (writeByte & 0x0F) | (c & 0x0F) << 4;
+    }
+  }
+  void pageData(uint8_t d) {
+    if (writeRow < pageCount && writeByte < pageColumns) pageRam[writeRow * pageColumns + writeByte] = d;
+    writeByte++;
+    if (horizontal && writeByte > columnEnd) {
+      writeByte = columnStart;
+      if (++writeRow > rowEnd) writeRow = rowStart;
+    }
+  }
+};
+
+class U8G2 {
+ public:
+  U8G2(int width, int height) { setDisplaySize(width, height); }
+
+  void setDisplaySize(int width, int height) {
+    displayWidth = width;
+    displayHeight = height;
+    buffer.assign(width * ((height + 7) / 8), 0);
+  }
+
+  void begin() {}
+  void setDrawColor(uint8_t) {}
+  void setFont(const uint8_t *) {}
+  void setContrast(uint8_t value) { contrast = value; }
+  void setPowerSave(uint8_t on) { powerSave = on; }
+  void setBusClock(uint32_t hz) { busClock = hz; }
+
+  void clearBuffer() { memset(buffer.data(), 0, buffer.size()); }
+  void sendBuffer() { framesSent++; }
+  void updateDisplayArea(uint8_t, uint8_t, uint8_t, uint8_t) { areasSent++; }
+
+  void drawPixel(int x, int y) {
+    if (x < 0 || y < 0 || x >= displayWidth || y >= displayHeight) return;
+    buffer[(y >> 3) * displayWidth + x] |= 1 << (y & 7);
+  }
+  void drawHLine(int x, int y, int w) {
+    for (int i = 0; i < w; i++) drawPixel(x + i, y);
+  }
+  void drawVLine(int x, int y, int h) {
+    for (int i = 0; i < h; i++) drawPixel(x, y + i);
+  }
+  void drawBox(int x, int y, int w, int h) {
+    for (int i = 0; i < h; i++) drawHLine(x, y + i, w);
+  }
+  void drawLine(int x0, int y0, int x1, int y1) {
+    int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+      drawPixel(x0, y0);
+      if (x0 == x1 && y0 == y1) break;
+      int e2 = 2 * err;
+      if (e2 >= dy) { err += dy; x0 += sx; }
+      if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+  }
+
+  u8x8_t *getU8x8() { return &u8x8; }
+  uint8_t *getBufferPtr() { return buffer.data(); }
+  uint8_t getBufferTileWidth() { return displayWidth / 8; }
+  uint8_t getBufferTileHeight() { return (displayHeight + 7) / 8; }
+  int getDisplayWidth() { return displayWidth; }
+  int getDisplayHeight() { return displayHeight; }
+
+  bool getPixel(int x, int y) const {
+    return buffer[(y >> 3) * displayWidth + x] & (1 << (y & 7));
+  }
+
+  uint8_t contrast = 255;
+  uint8_t powerSave = 0;
+  uint32_t busClock = 0;
+  unsigned long framesSent = 0;
+  unsigned long areasSent = 0;
+  u8x8_t u8x8;
+
+ private:
+  int displayWidth = 0;
+  int displayHeight = 0;
+  std::vector<uint8_t> buffer;
+};
+
+// The display classes main.cpp can be built for
+struct U8G2_SSD1306_128X64_NONAME_F_HW_I2C : U8G2 {
+  U8G2_SSD1306_128X64_NONAME_F_HW_I2C(const void *, uint8_t, uint8_t = 0, uint8_t = 0) : U8G2(128, 64) {}
+};
+struct U8G2_SSD1306_128X64_NONAME_F_4W_HW_SPI : U8G2 {
+  U8G2_SSD1306_128X64_NONAME_F_4W_HW_SPI(const void *, uint8_t, uint8_t, uint8_t) : U8G2(128, 64) {}
+};
+struct U8G2_SH1107_128X128_F_HW_I2C : U8G2 {
+  U8G2_SH1107_128X128_F_HW_I2C(const void *, uint8_t, uint8_t = 0, uint8_t = 0) : U8G2(128, 128) {}
+};
+struct U8G2_SH1107_128X128_F_4W_HW_SPI : U8G2 {
+  U8G2_SH1107_128X128_F_4W_HW_SPI(const void *, uint8_t, uint8_t, uint8_t) : U8G2(128, 128) {}
+};
+struct U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI : U8G2 {
+  U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI(const void *, uint8_t, uint8_t, uint8_t) : U8G2(256, 64) {
+    u8x8.controller = u8x8_t::SSD1322;
+  }
+};
@@ -0,0 +1,4 @@
+// Host stand-in for the Arduino Wire library; the host display never touches a bus.
+#pragma once
+
+#include "Arduino.h"
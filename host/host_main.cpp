@@ -0,0 +1,1442 @@
+// Host build of the sketch, for benchmarks off the device.
+//
+//   g++ -std=c++17 -O2 -Ihost host/host_main.cpp -o fredrick-host
+//   ./fredrick-host bench    frame time per panel size
+//   ./fredrick-host strokes  mouth and lid curves, stroke engine vs the old
+//                            per-x parabola sampling
+//   ./fredrick-host gray     1-bit vs 4-bit grayscale on the 256x64 panel
+//   ./fredrick-host bus      bytes/s and frame rate per panel and bus
+//   ./fredrick-host sim [hours] [seed] [trace]
+//                            fast-forward soak test of the loop() state machine
+//   ./fredrick-host tasks [seconds] [seed]
+//                            per-task latency with the send on 400 kHz I2C,
+//                            over at least one expression cycle
+//   ./fredrick-host dither [seconds] [seed]
+//                            temporal dither subframe rate per bus on the
+//                            SSD1306, diff transfer vs whole subframes
+//   ./fredrick-host profile [seconds] [seed]
+//                            print profiler dumps (needs -DPROFILE)
+//   ./fredrick-host report   read profiler dumps on stdin, print min/avg/p99
+//   ./fredrick-host ram [file.su]
+//                            static RAM of the sketch's state, and the largest
+//                            stack frames from a -fstack-usage build
+//   ./fredrick-host facec [-b] [file.face...]
+//                            compile face programs to a C header (or one to
+//                            raw bytes for LittleFS with -b)
+//   ./fredrick-host faces [dir]
+//                            check face programs against the hand-written
+//                            expressions they mirror, and time both
+//
+// The whole sketch is compiled into this translation unit so the host
+// driver can reach its globals and draw functions directly.
+#define HOST_BUILD
+#include "../main.cpp"
+
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Panel {
+  const char *name;
+  int width;
+  int height;
+  PanelController controller;
+};
+
+const Panel benchPanels[] = {
+  {"SSD1306 128x64", 128, 64, CONTROLLER_SSD1306},
+  {"SH1107 128x128", 128, 128, CONTROLLER_SH1107},
+  {"SSD1322 256x64", 256, 64, CONTROLLER_SSD1322},
+};
+
+// Switch the host display, its RAM model and the layout to a panel
+void usePanel(const Panel &panel) {
+  u8g2.setDisplaySize(panel.width, panel.height);
+  panelController = panel.controller;
+  u8g2.getU8x8()->controller = panel.controller == CONTROLLER_SSD1322 ? u8x8_t::SSD1322 : u8x8_t::SSD13XX;
+  resolveLayout(panel.width, panel.height);
+}
+
+const char *const expressionNames[] = {
+  "HAPPY", "SAD", "NEUTRAL", "WINK", "ANGRY", "SURPRISED", "CRYING", "SLEEPY", "SLEEPING",
+};
+
+const EyeExpression benchExpressions[] = {
+  HAPPY, SAD, NEUTRAL, ANGRY, SURPRISED, CRYING, SLEEPY, SLEEPING,
+};
+
+double nowMicros() {
+  using namespace std::chrono;
+  return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Average time to clear the buffer and draw one face, over every expression
+double benchFrameMicros(int frames) {
+  double total = 0.0;
+  for (EyeExpression expression : benchExpressions) {
+    face.currentExpression = expression;
+    double start = nowMicros();
+    for (int i = 0; i < frames; i++) {
+      // Walk the eyes around so every frame is not identical
+      face.eyeOffsetX = face.mouthOffsetX = (i % 17) - 8;
+      face.eyeOffsetY = face.mouthOffsetY = (i % 11) - 5;
+      u8g2.clearBuffer();
+      drawFace();
+    }
+    total += nowMicros() - start;
+  }
+  return total / (frames * (sizeof(benchExpressions) / sizeof(benchExpressions[0])));
+}
+
+// Frame time per panel; the time ratio should not outgrow the pixel ratio
+int runBench(int frames) {
+  double baseMicros = 0.0;
+  int basePixels = 0;
+  benchFrameMicros(frames / 4 + 1);  // Warm up caches and the branch predictor
+  printf("%-16s %8s %10s %10s %8s %8s\n", "panel", "pixels", "us/frame", "ns/pixel", "x pixels", "x time");
+  for (const Panel &panel : benchPanels) {
+    usePanel(panel);
+    int pixels = panel.width * panel.height;
+    double micros = benchFrameMicros(frames);
+    if (basePixels == 0) {
+      basePixels = pixels;
+      baseMicros = micros;
+    }
+    printf("%-16s %8d %10.2f %10.3f %8.2f %8.2f\n", panel.name, pixels, micros, micros * 1000.0 / pixels,
+           (double)pixels / basePixels, micros / baseMicros);
+  }
+  return 0;
+}
+
+// Stroke engine against what it replaced
+// Before drawStrokeQuad the mouths and lids were parabolas sampled once per x,
+// with a drawPixel per row of thickness and one more above near the ends.
+void drawSampledParabola(int cx, int apexY, int half, int rise, int width) {
+  for (int x = -half; x <= half; x++) {
+    float xf = (float)x / half;
+    int y = apexY + (int)(rise * xf * xf);
+    for (int o = 0; o < width; o++) {
+      u8g2.drawPixel(cx + x, y + o);
+    }
+    if (abs(x) >= half - 2) {
+      u8g2.drawPixel(cx + x, y - 1);
+    }
+  }
+}
+
+// Time each curve both ways on the default panel, best of several rounds
+int runStrokeBench(int frames) {
+  usePanel(benchPanels[0]);
+  struct Curve {
+    const char *name;
+    int y;      // Apex row
+    int half;
+    int rise;   // Corners relative to the apex
+  } curves[] = {
+    {"smile", layout[MOUTH_Y], layout[MOUTH_HALF], -layout[SMILE_DEPTH]},
+    {"sad", layout[MOUTH_Y], layout[SAD_MOUTH_HALF], layout[SAD_MOUTH_DEPTH]},
+    {"lid", layout[EYE_Y] - layout[LID_RISE], layout[LID_HALF], layout[LID_RISE]},
+  };
+  const int width = layout[STROKE_BOLD];
+
+  printf("%-8s %12s %12s %8s\n", "curve", "ns/sampled", "ns/stroke", "x time");
+  for (const Curve &curve : curves) {
+    double best[2] = {1e30, 1e30};
+    for (int round = 0; round < 20; round++) {
+      for (int pass = 0; pass < 2; pass++) {
+        bool stroke = (round + pass) % 2;
+        u8g2.clearBuffer();
+        double start = nowMicros();
+        for (int i = 0; i < frames; i++) {
+          int cx = layout[FACE_CENTER_X] + (i % 17) - 8;
+          int cy = curve.y + (i % 11) - 5;
+          if (stroke) {
+            drawStrokeQuad(cx - curve.half, cy + curve.rise, cx, cy - curve.rise, cx + curve.half,
+                           cy + curve.rise, width);
+          } else {
+            drawSampledParabola(cx, cy, curve.half, curve.rise, width);
+          }
+        }
+        best[stroke] = min(best[stroke], (nowMicros() - start) * 1000.0 / frames);
+      }
+    }
+    printf("%-8s %12.1f %12.1f %8.2f\n", curve.name, best[0], best[1], best[1] / best[0]);
+  }
+  return 0;
+}
+
+// True when the modelled SSD1322 RAM window shows exactly grayBuffer
+bool grayRamMatches() {
+  const u8x8_t &u8x8 = *u8g2.getU8x8();
+  for (int y = 0; y < grayHeight; y++) {
+    const uint8_t *ram = &u8x8.ram[y * u8x8_t::ramRowBytes + grayColumnStart * 2];
+    if (memcmp(ram, &grayBuffer[y * grayRowBytes], grayRowBytes) != 0) return false;
+  }
+  return true;
+}
+
+// Render and send the same frames through both paths on the 256x64 panel.
+// The grayscale path has to fit in the monochrome frame budget.
+int runGrayBench(int frames) {
+  usePanel(benchPanels[2]);
+
+  printf("%-10s %10s %10s %12s %8s\n", "path", "us/frame", "us/send", "bytes/frame", "ram ok");
+  bool ok = true;
+  for (int pass = 0; pass < 2; pass++) {
+    grayscale = pass == 1;
+    u8x8_t &u8x8 = *u8g2.getU8x8();
+    unsigned long bytesBefore = u8x8.bytesSent;
+    double drawMicros = 0.0;
+    double sendMicros = 0.0;
+    bool ramOk = true;
+    for (int i = 0; i < frames; i++) {
+      face.currentExpression = benchExpressions[(i / 8) % (sizeof(benchExpressions) / sizeof(benchExpressions[0]))];
+      face.eyeOffsetX = face.mouthOffsetX = (i % 17) - 8;
+      face.eyeOffsetY = face.mouthOffsetY = (i % 11) - 5;
+      double start = nowMicros();
+      clearFrame();
+      drawFace();
+      double drawn = nowMicros();
+      sendFrame();
+      sendMicros += nowMicros() - drawn;
+      drawMicros += drawn - start;
+      if (grayscale) ramOk = ramOk && grayRamMatches();
+    }
+    // U8g2 expands 1-bit frames to 4 bits per pixel for the SSD1322 and
+    // always sends all of display RAM; the host does not model that send
+    double bytesPerFrame = grayscale ? (double)(u8x8.bytesSent - bytesBefore) / frames
+                                     : grayRowBytes * grayHeight;
+    printf("%-10s %10.2f %10.2f %12.1f %8s\n", grayscale ? "gray4" : "mono", drawMicros / frames,
+           sendMicros / frames, bytesPerFrame, grayscale ? (ramOk ? "yes" : "NO") : "-");
+    ok = ok && ramOk;
+  }
+  grayscale = false;
+  return ok ? 0 : 1;
+}
+
+// Bus throughput
+// Frames go through the real sendFrame() and busWrite() with the chunk size
+// of each backend; the host backend counts the transactions and bytes, and
+// the wire time is worked out from the bus clock. I2C spends 9 clocks per
+// byte plus start, address, control byte and stop per transaction; SPI
+// spends 8 clocks per byte plus a fixed cost per transaction for chip
+// select, D/C and SPI.beginTransaction(). 'memory' is the host itself.
+enum BusKind { BUS_MEMORY, BUS_I2C, BUS_SPI_WIRE };
+
+struct BusConfig {
+  const char *name;
+  BusKind kind;
+  uint32_t clockHz;
+  uint16_t maxTransfer;
+};
+
+const BusConfig busConfigs[] = {
+  {"memory", BUS_MEMORY, 0, 0xFFFF},
+  {"i2c 400k/24B", BUS_I2C, 400000, 24},  // U8g2's own I2C chunking
+  {"i2c 400k", BUS_I2C, 400000, 127},      // ESP32 Wire buffer less the control byte
+  {"i2c 1M", BUS_I2C, 1000000, 127},
+  {"spi 8M", BUS_SPI_WIRE, 8000000, 0xFFFF},
+};
+
+const double spiTransactionMicros = 2.0;
+
+double busWireSeconds(const BusConfig &bus, unsigned long transfers, unsigned long bytes) {
+  switch (bus.kind) {
+    case BUS_I2C:
+      return (9.0 * (bytes + 2 * transfers) + 2.0 * transfers) / bus.clockHz;
+    case BUS_SPI_WIRE:
+      return 8.0 * bytes / bus.clockHz + transfers * spiTransactionMicros / 1e6;
+    default:
+      return 0.0;
+  }
+}
+
+// True when the modelled panel RAM shows the frame just sent
+bool panelRamMatches() {
+  const u8x8_t &u8x8 = *u8g2.getU8x8();
+  if (grayscale && panelController == CONTROLLER_SSD1322) return grayRamMatches();
+  int width = u8g2.getBufferTileWidth() * 8;
+  for (int page = 0; page < u8g2.getBufferTileHeight(); page++) {
+    if (memcmp(&u8x8.pageRam[page * u8x8_t::pageColumns], u8g2.getBufferPtr() + page * width, width) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Bytes/s and frame rate for every panel on every bus it can be wired to.
+// The SSD1322 is SPI only and runs the 4-bit path, which skips unchanged rows.
+int runBusBench(int frames) {
+  printf("%-16s %-13s %8s %9s %10s %10s %9s %7s\n", "panel", "bus", "txn/frm", "bytes/frm", "wire us", "bytes/s",
+         "bus fps", "ram ok");
+  bool ok = true;
+  for (const Panel &panel : benchPanels) {
+    usePanel(panel);
+    grayscale = panel.controller == CONTROLLER_SSD1322;
+    for (const BusConfig &bus : busConfigs) {
+      if (grayscale && bus.kind == BUS_I2C) continue;
+      displayBus.maxTransfer = bus.maxTransfer;
+      displayBus.clockHz = bus.clockHz;
+      grayRowHashesValid = false;
+
+      u8x8_t &u8x8 = *u8g2.getU8x8();
+      unsigned long transfersBefore = u8x8.transfers;
+      unsigned long bytesBefore = u8x8.bytesSent;
+      double sendMicros = 0.0;
+      bool ramOk = true;
+      for (int i = 0; i < frames; i++) {
+        face.currentExpression = benchExpressions[(i / 8) % (sizeof(benchExpressions) / sizeof(benchExpressions[0]))];
+        face.eyeOffsetX = face.mouthOffsetX = (i % 17) - 8;
+        face.eyeOffsetY = face.mouthOffsetY = (i % 11) - 5;
+        clearFrame();
+        drawFace();
+        double start = nowMicros();
+        sendFrame();
+        sendMicros += nowMicros() - start;
+        ramOk = ramOk && panelRamMatches();
+      }
+
+      unsigned long transfers = u8x8.transfers - transfersBefore;
+      unsigned long bytes = u8x8.bytesSent - bytesBefore;
+      double wireSeconds = bus.kind == BUS_MEMORY ? sendMicros / 1e6 : busWireSeconds(bus, transfers, bytes);
+      double perFrame = wireSeconds / frames;
+      printf("%-16s %-13s %8.1f %9.0f %10.1f %10.0f %9.1f %7s\n", panel.name, bus.name, (double)transfers / frames,
+             (double)bytes / frames, perFrame * 1e6, bytes / max(wireSeconds, 1e-12), 1.0 / max(perFrame, 1e-12),
+             ramOk ? "yes" : "NO");
+      ok = ok && ramOk;
+    }
+  }
+  displayBus.maxTransfer = 0xFFFF;
+  displayBus.clockHz = 0;
+  grayscale = false;
+  return ok ? 0 : 1;
+}
+
+// Deterministic fast-forward simulation
+// loop() runs against a virtual clock that only moves when the sketch sleeps,
+// so hours of animation take seconds. The clock starts just before the
+// 32-bit millis() wrap so every run crosses it.
+uint32_t simNow = 0;               // millis() of the simulation
+uint64_t simElapsed = 0;           // Milliseconds since the start
+uint64_t simElapsedMicros = 0;
+uint32_t simMicrosStart = 0;
+
+uint32_t simClock() { return simNow; }
+uint32_t simMicros() { return simMicrosStart + (uint32_t)simElapsedMicros; }
+
+void simAdvanceMicros(uint64_t us) {
+  simElapsedMicros += us;
+  uint64_t ms = simElapsedMicros / 1000;
+  simNow += (uint32_t)(ms - simElapsed);
+  simElapsed = ms;
+}
+
+void simSleep(uint32_t ms) {
+  simAdvanceMicros(ms * 1000ULL);
+}
+
+// Point the sketch at the virtual clock, reading 'startMillis'. micros()
+// starts 30 s before its own wrap.
+void useSimClock(uint32_t startMillis) {
+  simNow = startMillis;
+  simElapsed = simElapsedMicros = 0;
+  simMicrosStart = 0xFFFFFFFFUL - 30000000UL;
+  faceClock = simClock;
+  faceMicros = simMicros;
+  faceSleep = simSleep;
+  for (int i = 0; i < taskCount; i++) {
+    tasks[i].due = faceMicros();
+  }
+  taskAwakeSince = simNow;
+}
+
+void usePlatformClock() {
+  faceClock = platformClock;
+  faceMicros = platformMicros;
+  faceSleep = platformSleep;
+}
+
+// Watches one of the sketch's timer stamps and records how far apart it fires.
+// Gaps come from the stamps themselves: loop() sleeps before the simulation
+// gets to look, so the observation time is later than the event.
+struct TimerWatch {
+  const char *name;
+  const FaceStamp *stamp;
+  uint32_t limit;       // Longest legal gap between two firings
+  FaceStamp lastStamp;
+  bool rearm;           // Do not measure the next gap (timer was paused)
+  uint32_t maxGap;
+  unsigned long fires;
+  unsigned long late;   // Gaps longer than the limit
+};
+
+// Elapsed simulation time at which the clock's low 16 bits read 'stamp'
+uint64_t elapsedAt(FaceStamp stamp) {
+  return simElapsed - (FaceStamp)(simNow - stamp);
+}
+
+struct ExpressionCoverage {
+  unsigned long entries;
+  unsigned long frames;
+  uint64_t totalMs;
+  uint64_t minDwell;
+  uint64_t maxDwell;
+};
+
+void traceEvent(bool trace, FaceStamp stamp, const char *event, const char *detail) {
+  if (trace) {
+    uint32_t millis = simNow - (FaceStamp)(simNow - stamp);
+    printf("%llu,%lu,%s,%s\n", (unsigned long long)elapsedAt(stamp), (unsigned long)millis, event, detail);
+  }
+}
+
+int runSim(double hours, uint32_t seed, bool trace) {
+  useSimClock(0xFFFFFFFFUL - 30000);
+  faceRandomSeed(seed);
+
+  // Boot at simNow rather than at zero
+  face.lastBlinkTime = face.lastEyeMoveTime = face.lastTearUpdateTime = face.lastExpressionChange = simNow;
+
+  // Timers may fire late by at most one animation frame
+  const uint32_t slack = frameInterval;
+  TimerWatch timers[] = {
+    {"blink", &face.lastBlinkTime, 5000 + slack, 0, false, 0, 0, 0},
+    {"eye move", &face.lastEyeMoveTime, 2500 + slack, 0, false, 0, 0, 0},
+    {"expression", &face.lastExpressionChange, 7000 + slack, 0, false, 0, 0, 0},
+    {"tear", &face.lastTearUpdateTime, (uint32_t)tearUpdateInterval + slack, 0, true, 0, 0, 0},
+  };
+  TimerWatch &tearWatch = timers[3];
+  for (TimerWatch &timer : timers) {
+    timer.lastStamp = *timer.stamp;
+  }
+
+  ExpressionCoverage coverage[expressionCount] = {};
+  for (ExpressionCoverage &c : coverage) {
+    c.minDwell = UINT64_MAX;
+  }
+  EyeExpression expression = face.currentExpression;
+  uint64_t enteredAt = 0;
+  coverage[expression].entries++;
+
+  const uint64_t target = (uint64_t)(hours * 3600000.0);
+  unsigned long loops = 0;
+  unsigned long spinLoops = 0;
+  unsigned long framesBefore = framesSent;
+  bool wrapped = false;
+  bool spinning = false;
+
+  if (trace) printf("elapsed_ms,millis,event,detail\n");
+  double wallStart = nowMicros();
+  while (simElapsed < target) {
+    uint64_t before = simElapsed;
+    uint32_t clockBefore = simNow;
+    loop();
+    loops++;
+    wrapped = wrapped || simNow < clockBefore;
+
+    // A loop that never lets time pass is a busy spin
+    if (simElapsed == before) {
+      if (++spinLoops > 1000) {
+        spinning = true;
+        break;
+      }
+    } else {
+      spinLoops = 0;
+    }
+
+    coverage[expression].frames += framesSent - framesBefore;
+    framesBefore = framesSent;
+
+    if (face.currentExpression != expression) {
+      uint64_t changedAt = elapsedAt(face.lastExpressionChange);
+      ExpressionCoverage &left = coverage[expression];
+      uint64_t dwell = changedAt - enteredAt;
+      left.totalMs += dwell;
+      left.minDwell = min(left.minDwell, dwell);
+      left.maxDwell = max(left.maxDwell, dwell);
+
+      expression = face.currentExpression;
+      enteredAt = changedAt;
+      coverage[expression].entries++;
+      traceEvent(trace, face.lastExpressionChange, "expression", expressionNames[expression]);
+
+      // Tears only tick while crying, so the gap up to the restamp on
+      // entering spans the whole time away
+      if (expression == CRYING) tearWatch.rearm = true;
+    }
+
+    for (TimerWatch &timer : timers) {
+      if (*timer.stamp == timer.lastStamp) continue;
+      uint32_t gap = (FaceStamp)(*timer.stamp - timer.lastStamp);
+      if (!timer.rearm) {
+        timer.maxGap = max(timer.maxGap, gap);
+        if (gap > timer.limit) timer.late++;
+      }
+      timer.rearm = false;
+      timer.fires++;
+      timer.lastStamp = *timer.stamp;
+      if (&timer == &timers[0]) traceEvent(trace, face.lastBlinkTime, face.isBlinking ? "blink" : "unblink", "");
+      if (&timer == &timers[1]) {
+        char detail[32];
+        snprintf(detail, sizeof(detail), "%d %d", face.eyeOffsetX, face.eyeOffsetY);
+        traceEvent(trace, face.lastEyeMoveTime, "look", detail);
+      }
+    }
+  }
+  double wallSeconds = (nowMicros() - wallStart) / 1e6;
+  coverage[expression].totalMs += simElapsed - enteredAt;
+  usePlatformClock();
+
+  // Report
+  double simSeconds = simElapsed / 1000.0;
+  printf("simulated %.1f s in %.3f s wall (%.0fx), %lu loops, seed %lu, millis wrapped: %s\n", simSeconds,
+         wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0.0, loops, (unsigned long)seed,
+         wrapped ? "yes" : "no");
+
+  printf("\n%-10s %8s %8s %7s %10s %10s\n", "state", "entries", "frames", "time%", "min dwell", "max dwell");
+  bool unvisited = false;
+  for (int i = 0; i < expressionCount; i++) {
+    const ExpressionCoverage &c = coverage[i];
+    if (c.entries == 0) {
+      printf("%-10s %8s\n", expressionNames[i], "never");
+      // WINK is not part of the expression cycle
+      if (i != WINK) unvisited = true;
+      continue;
+    }
+    printf("%-10s %8lu %8lu %6.1f%% %10llu %10llu\n", expressionNames[i], c.entries, c.frames,
+           100.0 * c.totalMs / max(simElapsed, (uint64_t)1),
+           (unsigned long long)(c.minDwell == UINT64_MAX ? 0 : c.minDwell), (unsigned long long)c.maxDwell);
+  }
+
+  printf("\n%-10s %8s %10s %8s %6s\n", "timer", "fires", "max gap", "limit", "late");
+  unsigned long late = 0;
+  for (const TimerWatch &timer : timers) {
+    printf("%-10s %8lu %10lu %8lu %6lu\n", timer.name, timer.fires, (unsigned long)timer.maxGap,
+           (unsigned long)timer.limit, timer.late);
+    late += timer.late;
+  }
+
+  bool ok = !spinning && late == 0 && !(unvisited && simElapsed > 3600000);
+  if (spinning) printf("\nFAIL: loop() stopped advancing time after %lu loops\n", loops);
+  if (late) printf("\nFAIL: %lu timer firings came late (stuck state?)\n", late);
+  if (unvisited && simElapsed > 3600000) printf("\nFAIL: an expression in the cycle was never reached\n");
+  return ok ? 0 : 1;
+}
+
+#ifdef PROFILE
+// Run loop() on the virtual clock and let the sketch's own profiler dump to
+// stdout, exactly as it would over serial
+int runProfile(double seconds, uint32_t seed) {
+  useSimClock(0);
+  faceRandomSeed(seed);
+  const uint64_t target = (uint64_t)(seconds * 1000.0);
+  while (simElapsed < target) {
+    loop();
+  }
+  profileDump();
+  usePlatformClock();
+  return 0;
+}
+#endif
+
+// Task latency
+// The sketch runs on the virtual clock with the panel on 400 kHz I2C, and
+// every bus transaction moves the clock on by its wire time, so a frame takes
+// as long to send as on the device. Time the sketch spends computing is
+// charged too: each clock read first adds the host time since the last one
+// (the host is faster than the MCU, so steps come out short of the device's).
+// A probe task stands in for a sensor read every probeInterval; its lateness
+// is how long it waits behind the render task. A loop that drew and sent a
+// whole frame before looking at anything else would make it wait up to the
+// full frame time. The run lasts at least one full expression cycle.
+const BusConfig &taskBus = busConfigs[2];
+const BusConfig *simBus = &taskBus;  // Wire time simBusTransfer() charges
+const uint32_t probeInterval = 10;    // ms
+const uint32_t probeCostMicros = 200;
+unsigned long probeReads = 0;
+uint64_t frameBusMicros = 0;
+bool chargeCpu = false;   // Clock reads charge host time (task bench only)
+double cpuMark = 0.0;     // nowMicros() up to which host time is charged
+
+void chargeCpuTime() {
+  if (!chargeCpu) return;
+  uint64_t spent = (uint64_t)(nowMicros() - cpuMark);
+  cpuMark += spent;
+  simAdvanceMicros(spent);
+}
+
+uint32_t cpuClock() {
+  chargeCpuTime();
+  return simClock();
+}
+
+uint32_t cpuMicros() {
+  chargeCpuTime();
+  return simMicros();
+}
+
+void simBusTransfer(bool data, const uint8_t *bytes, uint16_t count) {
+  chargeCpuTime();
+  hostBusTransfer(data, bytes, count);
+  uint64_t wire = (uint64_t)(busWireSeconds(*simBus, 1, count) * 1e6 + 0.5);
+  frameBusMicros += wire;
+  simAdvanceMicros(wire);
+  // The host's copy is not the sketch's work; the wire time stands for it
+  cpuMark = nowMicros();
+}
+
+void runProbeTask(Task &task) {
+  TASK_BEGIN(task);
+  while (true) {
+    simAdvanceMicros(probeCostMicros);
+    probeReads++;
+    TASK_SLEEP_UNTIL(task, task.due + probeInterval * 1000UL);
+  }
+  TASK_END(task);
+}
+
+int runTasks(double seconds, uint32_t seed) {
+  useSimClock(0);
+  faceClock = cpuClock;
+  faceMicros = cpuMicros;
+  faceRandomSeed(seed);
+  displayBus.maxTransfer = taskBus.maxTransfer;
+  displayBus.clockHz = taskBus.clockHz;
+  displayBus.transfer = simBusTransfer;
+  Task *probe = taskAdd("probe", runProbeTask);
+  for (int i = 0; i < taskCount; i++) {
+    tasks[i].runs = tasks[i].lateSumMicros = tasks[i].lateMaxMicros = tasks[i].stepMaxMicros = 0;
+  }
+
+  // Frame rate while SLEEPING, the one face that animates every frame. Runs
+  // on until the cycle is back at the expression it started from, so every
+  // state is seen however short 'seconds' is.
+  const uint64_t target = (uint64_t)(seconds * 1000.0);
+  const EyeExpression first = face.currentExpression;
+  bool cycled = false;
+  bool left = false;
+  uint64_t sleepingMs = 0;
+  unsigned long sleepingFrames = 0;
+  unsigned long framesBefore = framesSent;
+  uint64_t longestLate = 0;
+  while ((simElapsed < target || !cycled) && simElapsed < target + 3600000) {
+    uint64_t before = simElapsed;
+    bool sleeping = face.currentExpression == SLEEPING;
+    cpuMark = nowMicros();
+    chargeCpu = true;
+    loop();
+    chargeCpuTime();
+    chargeCpu = false;
+    if (sleeping && face.currentExpression == SLEEPING) {
+      sleepingMs += simElapsed - before;
+      sleepingFrames += framesSent - framesBefore;
+    }
+    framesBefore = framesSent;
+    left = left || face.currentExpression != first;
+    cycled = cycled || (left && face.currentExpression == first);
+  }
+  usePlatformClock();
+
+  printf("%.0f s simulated on %s, %lu frames, %.0f us of bus time per frame\n", simElapsed / 1000.0, taskBus.name,
+         framesSent, (double)frameBusMicros / max(framesSent, 1UL));
+  printf("SLEEPING: %.1f fps (target %.1f)\n\n", sleepingFrames * 1000.0 / max(sleepingMs, (uint64_t)1),
+         1000.0 / frameInterval);
+  printf("%-8s %9s %12s %12s %12s\n", "task", "runs", "avg late us", "max late us", "max step us");
+  for (int i = 0; i < taskCount; i++) {
+    const Task &task = tasks[i];
+    printf("%-8s %9lu %12lu %12lu %12lu\n", task.name, (unsigned long)task.runs,
+           (unsigned long)(task.runs ? task.lateSumMicros / task.runs : 0), (unsigned long)task.lateMaxMicros,
+           (unsigned long)task.stepMaxMicros);
+    if (&task != probe) longestLate = max(longestLate, (uint64_t)task.stepMaxMicros);
+  }
+
+  // The probe may wait for the longest step of another task, plus the
+  // millisecond granularity of the scheduler's sleeps
+  bool ok = probe->lateMaxMicros <= longestLate + 1000;
+  if (!ok) printf("\nFAIL: probe waited longer than any other task's step\n");
+  if (!cycled || sleepingFrames == 0) {
+    printf("\nFAIL: the expression cycle did not come round within an hour\n");
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
+
+// Temporal dither
+// The sketch runs with DITHER's gray path on the SSD1306, on the virtual
+// clock with every bus transaction charged its wire time, as in the task
+// bench. Each bus is run with the diff transfer and again with every
+// subframe sent whole; the diff has to keep the subframe rate where the
+// whole screen cannot. The CPU side is timed on the host separately.
+int runDitherBench(double seconds, uint32_t seed) {
+  usePanel(benchPanels[0]);
+  grayscale = true;
+  // Only -DDITHER builds of the sketch register the task themselves
+  if (!ditherTask) ditherTask = taskAdd("dither", runDitherTask);
+
+  // CPU cost of one quantize and one subframe
+  const int cpuRuns = 2000;
+  face.currentExpression = SLEEPY;
+  clearFrame();
+  drawFace();
+  double start = nowMicros();
+  for (int i = 0; i < cpuRuns; i++) {
+    ditherQuantize();
+  }
+  double quantized = nowMicros();
+  for (int i = 0; i < cpuRuns; i++) {
+    ditherSubframe(i % 3, u8g2.getBufferPtr());
+  }
+  printf("quantize %.2f us, subframe %.2f us on the host; target %.1f subframes/s\n\n",
+         (quantized - start) / cpuRuns, (nowMicros() - quantized) / cpuRuns, 1e6 / ditherSubframeInterval);
+
+  // Every run starts from the same face so they all see the same expressions
+  const FaceState startFace = face;
+  printf("%-13s %-5s %9s %9s %9s %9s %11s %7s %7s\n", "bus", "send", "txn/sub", "bytes/sub", "wire us", "sub/s",
+         "max late us", "fps", "ram ok");
+  bool ok = true;
+  for (const BusConfig &bus : busConfigs) {
+    for (int whole = 0; whole < 2; whole++) {
+      face = startFace;
+      useSimClock(0);
+      faceRandomSeed(seed);
+      simBus = &bus;
+      displayBus.maxTransfer = bus.maxTransfer;
+      displayBus.clockHz = bus.clockHz;
+      displayBus.transfer = simBusTransfer;
+      // Restart the dither task on the new clock, not mid-subframe
+      ditherShownValid = false;
+      ditherTask->resume = 0;
+      ditherTask->waiting = false;
+      ditherTask->runs = ditherTask->lateSumMicros = ditherTask->lateMaxMicros = ditherTask->stepMaxMicros = 0;
+
+      u8x8_t &u8x8 = *u8g2.getU8x8();
+      unsigned long transfersBefore = u8x8.transfers;
+      unsigned long bytesBefore = u8x8.bytesSent;
+      unsigned long subframesBefore = subframesSent;
+      unsigned long framesBefore = framesSent;
+      frameBusMicros = 0;
+      bool ramOk = true;
+      // Subframes stop while the panel is off or the face has no shades
+      uint64_t shadedMicros = 0;
+      unsigned long stretches = 0;  // Runs of shaded frames
+      bool wasShaded = false;
+      const uint64_t target = (uint64_t)(seconds * 1000.0);
+      while (simElapsed < target) {
+        if (whole) ditherShownValid = false;
+        unsigned long subframes = subframesSent;
+        uint64_t before = simElapsedMicros;
+        bool shaded = ditherActive();
+        loop();
+        if (shaded) shadedMicros += simElapsedMicros - before;
+        if (shaded && !wasShaded) stretches++;
+        wasShaded = shaded;
+        if (subframesSent != subframes) ramOk = ramOk && panelRamMatches();
+      }
+      usePlatformClock();
+
+      unsigned long subframes = max(subframesSent - subframesBefore, 1UL);
+      double simSeconds = simElapsed / 1000.0;
+      double subframeRate = subframes * 1e6 / max(shadedMicros, (uint64_t)1);
+      printf("%-13s %-5s %9.1f %9.0f %9.0f %9.1f %11lu %7.1f %7s\n", bus.name, whole ? "whole" : "diff",
+             (double)(u8x8.transfers - transfersBefore) / subframes, (double)(u8x8.bytesSent - bytesBefore) / subframes,
+             (double)frameBusMicros / subframes, subframeRate, (unsigned long)ditherTask->lateMaxMicros,
+             (framesSent - framesBefore) / simSeconds, ramOk ? "yes" : "NO");
+      ok = ok && ramOk;
+      // The stock 400 kHz bus has to hold the full rate with the diff
+      // transfer; only the subframe in flight as each shaded stretch ends
+      // may be missing
+      if (&bus == &taskBus && !whole && subframes + stretches < shadedMicros / ditherSubframeInterval) {
+        printf("FAIL: %s fell behind the subframe rate\n", bus.name);
+        ok = false;
+      }
+    }
+  }
+  displayBus.transfer = hostBusTransfer;
+  displayBus.maxTransfer = 0xFFFF;
+  displayBus.clockHz = 0;
+  simBus = &taskBus;
+  grayscale = false;
+  return ok ? 0 : 1;
+}
+
+// RAM footprint
+// Static RAM of the sketch's state, next to what the face's animation state
+// took as separate globals before it was packed into FaceState. Given the
+// .su file from a -fstack-usage build, also lists the largest stack frames.
+struct LegacyFaceState {
+  uint32_t lastBlinkTime;
+  bool isBlinking;
+  int blinkDuration, blinkInterval;
+  int eyeOffsetX, eyeOffsetY;
+  uint32_t lastEyeMoveTime;
+  int eyeMoveInterval;
+  int mouthOffsetX, mouthOffsetY;
+  uint32_t lastMouthMoveTime;
+  int mouthMoveInterval;
+  uint32_t lastTearUpdateTime;
+  int tearUpdateInterval, tearFrame, tearCount;
+  int currentExpression;
+  uint32_t lastExpressionChange;
+  int expressionDuration;
+  float sleepBubblePhase;
+  float bubbleLifecycles[3];
+  bool bubbleActive[3];
+  bool faceDirty;
+};
+
+struct StackFrame {
+  std::string function;
+  long bytes;
+};
+
+int runRam(const char *stackUsageFile) {
+  // The host carries every path; a device build only the one it shows, and
+  // DITHER sizes the gray buffer for 128 columns
+  const size_t grayBytes = sizeof(grayBuffer) + sizeof(grayRowHashes) + sizeof(coverageRow);
+  const size_t ditherGrayBytes = grayHeight * 128 / 2 + sizeof(grayRowHashes) + 128;
+  const size_t planeBytes = sizeof(ditherHigh) + sizeof(ditherLow) + sizeof(ditherShown);
+  struct Block {
+    const char *name;
+    size_t mono, gray4, dither;
+  };
+  const Block blocks[] = {
+    {"face state", sizeof(FaceState), sizeof(FaceState), sizeof(FaceState)},
+    {"layout", sizeof(layout), sizeof(layout), sizeof(layout)},
+    {"face programs", sizeof(faceCode) + sizeof(faceCodeStart) + sizeof(facePrograms),
+     sizeof(faceCode) + sizeof(faceCodeStart) + sizeof(facePrograms),
+     sizeof(faceCode) + sizeof(faceCodeStart) + sizeof(facePrograms)},
+    {"tasks", sizeof(tasks), sizeof(tasks), sizeof(tasks)},
+    {"power stats", sizeof(powerStats), sizeof(powerStats), sizeof(powerStats)},
+    {"frame buffer", 128 * 64 / 8, 256 * 64 / 8, 128 * 64 / 8},  // U8g2's
+    {"gray buffer", 0, grayBytes, ditherGrayBytes},
+    {"dither planes", 0, 0, planeBytes},
+#ifdef PROFILE
+    {"profiler (PROFILE)", sizeof(profileHistograms), sizeof(profileHistograms), sizeof(profileHistograms)},
+#endif
+  };
+  printf("%-22s %8s %8s %8s\n", "static bytes", "mono", "GRAY4", "DITHER");
+  size_t totals[3] = {0, 0, 0};
+  for (const Block &block : blocks) {
+    printf("%-22s %8zu %8zu %8zu\n", block.name, block.mono, block.gray4, block.dither);
+    totals[0] += block.mono;
+    totals[1] += block.gray4;
+    totals[2] += block.dither;
+  }
+  printf("%-22s %8zu %8zu %8zu\n", "total", totals[0], totals[1], totals[2]);
+  printf("\nface state %zu bytes, was %zu as separate globals: %zu faces fit in the old space\n", sizeof(FaceState),
+         sizeof(LegacyFaceState), sizeof(LegacyFaceState) / sizeof(FaceState));
+
+  if (!stackUsageFile) return 0;
+  std::ifstream in(stackUsageFile);
+  if (!in) {
+    fprintf(stderr, "ram: cannot read %s\n", stackUsageFile);
+    return 2;
+  }
+  // path:line:column:function<TAB>bytes<TAB>qualifiers
+  std::vector<StackFrame> frames;
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || line.find("main.cpp:") == std::string::npos) continue;
+    if (line.find("host_main.cpp:") != std::string::npos) continue;
+    size_t name = line.rfind(':', tab);
+    frames.push_back({line.substr(name + 1, tab - name - 1), atol(line.c_str() + tab + 1)});
+  }
+  std::sort(frames.begin(), frames.end(), [](const StackFrame &a, const StackFrame &b) { return a.bytes > b.bytes; });
+  printf("\n%-56s %8s\n", "largest stack frames", "bytes");
+  for (size_t i = 0; i < frames.size() && i < 12; i++) {
+    printf("%-56s %8ld\n", frames[i].function.c_str(), frames[i].bytes);
+  }
+  return 0;
+}
+
+const char *const profilePhaseNames[PROFILE_PHASES] = {
+  "update", "clear", "draw", "bubble", "send", "frame",
+};
+
+struct ProfileTotals {
+  uint64_t count = 0;
+  uint32_t minTicks = UINT32_MAX;
+  uint32_t maxTicks = 0;
+  uint64_t sumTicks = 0;
+  std::vector<uint64_t> buckets = std::vector<uint64_t>(profileBuckets);
+};
+
+// Duration below which 99% of the samples fall, to bucket precision
+uint32_t profileP99(const ProfileTotals &totals) {
+  uint64_t wanted = (totals.count * 99 + 99) / 100;
+  uint64_t seen = 0;
+  for (int b = 0; b < profileBuckets; b++) {
+    seen += totals.buckets[b];
+    if (seen >= wanted) {
+      uint32_t upper = b + 1 < profileBuckets ? profileBucketFloor(b + 1) - 1 : UINT32_MAX;
+      return min(upper, totals.maxTicks);
+    }
+  }
+  return totals.maxTicks;
+}
+
+// Parse profiler dumps from stdin (a serial log; other lines are skipped) and
+// print one row per expression and phase, merged over every dump
+int runReport() {
+  std::map<std::pair<int, int>, ProfileTotals> totals;
+  unsigned long dumps = 0;
+  unsigned long bad = 0;
+  double ticksPerMicro = 1.0;
+  char line[4096];
+  while (fgets(line, sizeof(line), stdin)) {
+    if (strncmp(line, "prof,", 5) == 0) {
+      unsigned long sequence, rate;
+      if (sscanf(line + 5, "%lu,%lu", &sequence, &rate) == 2 && rate > 0) ticksPerMicro = rate;
+      dumps++;
+      continue;
+    }
+    if (strncmp(line, "hist,", 5) != 0) continue;
+
+    char *cursor = line + 5;
+    unsigned long fields[6];
+    bool ok = true;
+    for (unsigned long &field : fields) {
+      char *end;
+      field = strtoul(cursor, &end, 10);
+      ok = ok && end != cursor;
+      cursor = *end == ',' ? end + 1 : end;
+    }
+    int slot = fields[0];
+    int phase = fields[1];
+    if (!ok || slot >= profileSlots || phase >= PROFILE_PHASES) {
+      bad++;
+      continue;
+    }
+    ProfileTotals &t = totals[{slot, phase}];
+    t.count += fields[2];
+    t.minTicks = min(t.minTicks, (uint32_t)fields[3]);
+    t.maxTicks = max(t.maxTicks, (uint32_t)fields[4]);
+    t.sumTicks += fields[5];
+    while (*cursor && *cursor != '\n') {
+      char *end;
+      unsigned long bucket = strtoul(cursor, &end, 10);
+      if (*end != ',') break;
+      unsigned long samples = strtoul(end + 1, &end, 10);
+      if (bucket < (unsigned long)profileBuckets) t.buckets[bucket] += samples;
+      cursor = *end == ',' ? end + 1 : end;
+    }
+  }
+  if (totals.empty()) {
+    fprintf(stderr, "no profiler dumps on stdin\n");
+    return 1;
+  }
+
+  printf("%lu dumps, %.0f ticks/us%s\n\n", dumps, ticksPerMicro, bad ? ", some lines unreadable" : "");
+  printf("%-10s %-7s %9s %10s %10s %10s %10s\n", "state", "phase", "samples", "min us", "avg us", "p99 us",
+         "max us");
+  for (const auto &entry : totals) {
+    const ProfileTotals &t = entry.second;
+    int slot = entry.first.first;
+    printf("%-10s %-7s %9llu %10.2f %10.2f %10.2f %10.2f\n",
+           slot == profileBlinkSlot ? "BLINK" : expressionNames[slot], profilePhaseNames[entry.first.second],
+           (unsigned long long)t.count, t.minTicks / ticksPerMicro,
+           (double)t.sumTicks / max(t.count, (uint64_t)1) / ticksPerMicro, profileP99(t) / ticksPerMicro,
+           t.maxTicks / ticksPerMicro);
+  }
+  return 0;
+}
+
+// Face compiler
+// Text format, one statement per line, '#' starts a comment:
+//   face NAME                   expression the program draws (HAPPY, WINK, ...)
+//   dwell MIN MAX               milliseconds to hold the expression
+//   flags animates noblink      optional, see FaceFlags
+//   let name = expr             named value, expanded where it is used
+//   oval|lidded|line|quad|tears expr, expr, ...
+//   advance | bubbles expr, expr
+// An expr is terms joined by + and -. A term is an integer, a let name, a
+// variable (eyeX eyeY mouthX mouthY breath tear tearAlt), a layout slot
+// (EYE_WIDTH) or a scaled slot (EYE_HEIGHT*3/4, LID_RISE*2, EYE_HEIGHT/2).
+const char *const layoutSlotNames[] = {
+  "LEFT_EYE_X", "RIGHT_EYE_X", "FACE_CENTER_X", "BUBBLE_X",
+  "EYE_Y", "EYE_LOW_Y", "EYE_TOP_Y", "MOUTH_Y", "MOUTH_LOW_Y", "SURPRISED_MOUTH_DROP",
+  "EYE_RANGE_X", "EYE_RANGE_Y",
+  "EYE_WIDTH", "EYE_HEIGHT", "SAD_EYE_HALF", "SAD_EYE_DEPTH", "EYE_SLANT",
+  "ANGRY_EYE_WIDTH", "ANGRY_EYE_HEIGHT", "ANGRY_EYE_CURVE",
+  "LID_HALF", "LID_RISE", "WINK_EYE_DEPTH", "WINK_EYE_LIFT",
+  "MOUTH_HALF", "SMILE_DEPTH", "SAD_MOUTH_HALF", "SAD_MOUTH_DEPTH",
+  "SLEEPY_MOUTH_HALF", "SLEEPY_MOUTH_END", "SLEEPING_MOUTH_HALF",
+  "WINK_MOUTH_HALF", "WINK_MOUTH_DEPTH",
+  "ANGRY_MOUTH_WIDTH", "ANGRY_MOUTH_HEIGHT", "TOOTH_SPACING",
+  "SURPRISED_MOUTH_WIDTH", "SURPRISED_MOUTH_HEIGHT",
+  "STROKE_THIN", "STROKE_BOLD", "TEAR_LENGTH",
+  "BUBBLE_DROP", "BUBBLE_RISE_X2", "Z_SIZE",
+  "BUBBLE_SIZE_0", "BUBBLE_SIZE_1", "BUBBLE_SIZE_2",
+  "BUBBLE_DX_0", "BUBBLE_DX_1", "BUBBLE_DX_2",
+  "BUBBLE_DY_0", "BUBBLE_DY_1", "BUBBLE_DY_2",
+};
+static_assert(sizeof(layoutSlotNames) / sizeof(layoutSlotNames[0]) == LAYOUT_SLOTS,
+              "layoutSlotNames out of step with LayoutSlot");
+
+const char *const faceVarNames[FACE_VARS] = {
+  "eyeX", "eyeY", "mouthX", "mouthY", "breath", "tear", "tearAlt",
+};
+
+const char *const faceOpNames[FACE_OPS] = {
+  "end", "oval", "lidded", "line", "quad", "advance", "bubbles", "tears",
+};
+
+struct FaceTermCode {
+  uint8_t kind;
+  uint8_t arg;
+  int num;
+  int den;
+};
+
+struct FaceCompiler {
+  std::string path;
+  int line = 0;
+  std::string error;
+  std::map<std::string, std::vector<FaceTermCode>> lets;
+
+  bool fail(const std::string &message) {
+    if (error.empty()) error = path + ":" + std::to_string(line) + ": " + message;
+    return false;
+  }
+
+  static std::string trim(const std::string &text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") + 1 - first);
+  }
+
+  static int lookup(const char *const *names, int count, const std::string &name) {
+    for (int i = 0; i < count; i++) {
+      if (name == names[i]) return i;
+    }
+    return -1;
+  }
+
+  static FaceTermCode negate(FaceTermCode term) {
+    switch (term.kind) {
+      case TERM_CONST: term.num = -term.num; break;
+      case TERM_SLOT: term.kind = TERM_SLOT_NEG; break;
+      case TERM_SLOT_NEG: term.kind = TERM_SLOT; break;
+      case TERM_VAR: term.kind = TERM_VAR_NEG; break;
+      case TERM_VAR_NEG: term.kind = TERM_VAR; break;
+      case TERM_SLOT_SCALED: term.num = -term.num; break;
+    }
+    return term;
+  }
+
+  bool parseTerm(const std::string &text, bool negative, std::vector<FaceTermCode> &terms) {
+    if (text.empty()) return fail("missing term");
+    if (isdigit((unsigned char)text[0])) {
+      char *end;
+      long value = strtol(text.c_str(), &end, 10);
+      if (*end) return fail("bad number '" + text + "'");
+      terms.push_back({TERM_CONST, 0, (int)(negative ? -value : value), 1});
+      return true;
+    }
+
+    // NAME, NAME*num, NAME/den or NAME*num/den
+    size_t nameEnd = text.find_first_of("*/");
+    std::string name = trim(text.substr(0, nameEnd));
+    int num = 1;
+    int den = 1;
+    if (nameEnd != std::string::npos) {
+      const char *cursor = text.c_str() + nameEnd;
+      char *end;
+      if (*cursor == '*') {
+        num = strtol(cursor + 1, &end, 10);
+        if (end == cursor + 1) return fail("bad scale in '" + text + "'");
+        cursor = end;
+      }
+      if (*cursor == '/') {
+        den = strtol(cursor + 1, &end, 10);
+        if (end == cursor + 1 || den <= 0) return fail("bad divisor in '" + text + "'");
+        cursor = end;
+      }
+      if (*trim(cursor).c_str()) return fail("bad term '" + text + "'");
+    }
+
+    bool scaled = num != 1 || den != 1;
+    auto let = lets.find(name);
+    if (let != lets.end()) {
+      if (scaled) return fail("cannot scale '" + name + "'");
+      for (const FaceTermCode &term : let->second) {
+        terms.push_back(negative ? negate(term) : term);
+      }
+      return true;
+    }
+    int var = lookup(faceVarNames, FACE_VARS, name);
+    if (var >= 0) {
+      if (scaled) return fail("cannot scale '" + name + "'");
+      terms.push_back({(uint8_t)(negative ? TERM_VAR_NEG : TERM_VAR), (uint8_t)var, 1, 1});
+      return true;
+    }
+    int slot = lookup(layoutSlotNames, LAYOUT_SLOTS, name);
+    if (slot < 0) return fail("unknown name '" + name + "'");
+    if (scaled) {
+      if (num < -128 || num > 127 || den > 255) return fail("scale out of range in '" + text + "'");
+      terms.push_back({TERM_SLOT_SCALED, (uint8_t)slot, negative ? -num : num, den});
+    } else {
+      terms.push_back({(uint8_t)(negative ? TERM_SLOT_NEG : TERM_SLOT), (uint8_t)slot, 1, 1});
+    }
+    return true;
+  }
+
+  // Split on top-level + and -, then fold the constants into one term
+  bool parseExpr(const std::string &text, std::vector<FaceTermCode> &terms) {
+    std::vector<FaceTermCode> parsed;
+    bool negative = false;
+    size_t start = 0;
+    std::string body = trim(text);
+    if (!body.empty() && (body[0] == '-' || body[0] == '+')) {
+      negative = body[0] == '-';
+      start = 1;
+    }
+    for (size_t i = start; i <= body.size(); i++) {
+      if (i == body.size() || body[i] == '+' || body[i] == '-') {
+        if (!parseTerm(trim(body.substr(start, i - start)), negative, parsed)) return false;
+        if (i < body.size()) negative = body[i] == '-';
+        start = i + 1;
+      }
+    }
+    int constant = 0;
+    for (const FaceTermCode &term : parsed) {
+      if (term.kind == TERM_CONST) {
+        constant += term.num;
+      } else {
+        terms.push_back(term);
+      }
+    }
+    if (constant < -128 || constant > 127) return fail("constant out of range");
+    if (constant != 0 || terms.empty()) terms.push_back({TERM_CONST, 0, constant, 1});
+    if (terms.size() > 255) return fail("expression too long");
+    return true;
+  }
+
+  static void emitOperand(const std::vector<FaceTermCode> &terms, std::vector<uint8_t> &out) {
+    out.push_back((uint8_t)terms.size());
+    for (const FaceTermCode &term : terms) {
+      out.push_back(term.kind);
+      out.push_back(term.kind == TERM_CONST ? (uint8_t)(int8_t)term.num : term.arg);
+      if (term.kind == TERM_SLOT_SCALED) {
+        out.push_back((uint8_t)(int8_t)term.num);
+        out.push_back((uint8_t)term.den);
+      }
+    }
+  }
+
+  bool compile(std::istream &in, std::vector<uint8_t> &program) {
+    int expression = -1;
+    long dwellMin = 4000;
+    long dwellMax = 7000;
+    uint8_t flags = 0;
+    std::vector<uint8_t> code;
+    std::string text;
+    while (std::getline(in, text)) {
+      line++;
+      text = trim(text.substr(0, text.find('#')));
+      if (text.empty()) continue;
+      size_t split = text.find_first_of(" \t");
+      std::string word = text.substr(0, split);
+      std::string rest = split == std::string::npos ? "" : trim(text.substr(split));
+      std::istringstream args(rest);
+
+      if (word == "face") {
+        std::string name;
+        args >> name;
+        expression = lookup(expressionNames, expressionCount, name);
+        if (expression < 0) return fail("unknown expression '" + name + "'");
+      } else if (word == "dwell") {
+        if (!(args >> dwellMin >> dwellMax) || dwellMin < 0 || dwellMin > dwellMax || dwellMax > maxExpressionDwell) {
+          return fail("dwell wants MIN MAX in milliseconds");
+        }
+      } else if (word == "flags") {
+        std::string flag;
+        while (args >> flag) {
+          if (flag == "animates") {
+            flags |= FACE_ANIMATES;
+          } else if (flag == "noblink") {
+            flags |= FACE_NO_BLINK;
+          } else {
+            return fail("unknown flag '" + flag + "'");
+          }
+        }
+      } else if (word == "let") {
+        size_t equals = rest.find('=');
+        if (equals == std::string::npos) return fail("let wants name = expr");
+        std::string name = trim(rest.substr(0, equals));
+        std::vector<FaceTermCode> terms;
+        if (!parseExpr(rest.substr(equals + 1), terms)) return false;
+        lets[name] = terms;
+      } else {
+        int op = lookup(faceOpNames, FACE_OPS, word);
+        if (op <= OP_END) return fail("unknown statement '" + word + "'");
+        std::vector<std::string> operands;
+        std::stringstream list(rest);
+        std::string operand;
+        while (std::getline(list, operand, ',')) operands.push_back(operand);
+        if ((int)operands.size() != faceOperandCounts[op]) {
+          return fail(word + " takes " + std::to_string(faceOperandCounts[op]) + " operands");
+        }
+        code.push_back((uint8_t)op);
+        for (const std::string &each : operands) {
+          std::vector<FaceTermCode> terms;
+          if (!parseExpr(each, terms)) return false;
+          emitOperand(terms, code);
+        }
+      }
+    }
+    if (expression < 0) return fail("missing 'face NAME'");
+    code.push_back(OP_END);
+
+    size_t size = faceHeaderSize + code.size();
+    if (size > 65535) return fail("program too large");
+    program = {'F', 'X', faceVersion, (uint8_t)expression, flags,
+               (uint8_t)dwellMin, (uint8_t)(dwellMin >> 8), (uint8_t)dwellMax, (uint8_t)(dwellMax >> 8),
+               (uint8_t)size, (uint8_t)(size >> 8)};
+    program.insert(program.end(), code.begin(), code.end());
+    if (!faceProgramValid(program.data(), program.size())) return fail("compiled program does not validate");
+    return true;
+  }
+};
+
+bool compileFaceFile(const char *path, std::vector<uint8_t> &program) {
+  std::ifstream in(path);
+  FaceCompiler compiler;
+  compiler.path = path;
+  if (!in) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+  if (!compiler.compile(in, program)) {
+    fprintf(stderr, "%s\n", compiler.error.c_str());
+    return false;
+  }
+  return true;
+}
+
+// faceWink from WINK
+std::string faceSymbol(int expression) {
+  std::string name = expressionNames[expression];
+  for (size_t i = 1; i < name.size(); i++) name[i] = tolower((unsigned char)name[i]);
+  return "face" + name;
+}
+
+int runFaceCompiler(int argc, char **argv) {
+  bool binary = argc > 0 && strcmp(argv[0], "-b") == 0;
+  if (binary) {
+    argc--;
+    argv++;
+  }
+  if (binary && argc != 1) {
+    fprintf(stderr, "facec: give exactly one .face file with -b\n");
+    return 2;
+  }
+
+  std::vector<std::vector<uint8_t>> programs;
+  for (int i = 0; i < argc; i++) {
+    programs.emplace_back();
+    if (!compileFaceFile(argv[i], programs.back())) return 1;
+  }
+  if (binary) {
+    fwrite(programs[0].data(), 1, programs[0].size(), stdout);
+    return 0;
+  }
+
+  printf("// Face programs compiled from faces/ by fredrick-host facec. Do not edit;\n");
+  printf("// change the .face sources and regenerate:\n");
+  printf("//   ./fredrick-host facec");
+  for (int i = 0; i < argc; i++) printf(" %s", argv[i]);
+  printf(" > faces.h\n#pragma once\n");
+  std::string table;
+  for (const std::vector<uint8_t> &program : programs) {
+    std::string symbol = faceSymbol(program[3]);
+    printf("\nconst uint8_t %s[] PROGMEM = {", symbol.c_str());
+    for (size_t i = 0; i < program.size(); i++) {
+      printf("%s0x%02x%s", i % 12 == 0 ? "\n  " : "", program[i], i + 1 < program.size() ? "," : "");
+      if (i % 12 != 11 && i + 1 < program.size()) printf(" ");
+    }
+    printf("\n};\n");
+    table += symbol + ", ";
+  }
+  printf("\n// Ends at nullptr, so the table may be empty\n");
+  printf("const uint8_t *const builtinFaces[] = {%snullptr};\n", table.c_str());
+  return 0;
+}
+
+// Animation state a frame may advance; restored so both renderers see the same
+struct FaceAnimationState {
+  FaceState state;
+  uint32_t random;
+
+  void save() {
+    state = face;
+    random = faceRandomState;
+  }
+  void restore() const {
+    face = state;
+    faceRandomState = random;
+  }
+};
+
+// Hand-written twin of each program, drawn as drawFace() would
+void drawBuiltinFace(int expression) {
+  switch (expression) {
+    case HAPPY: drawHappyEyes(); break;
+    case NEUTRAL: drawNeutralEyes(); break;
+    case WINK: drawWinkEyes(); break;
+    case CRYING: drawCryingEyes(face.tearFrame); break;
+    case SLEEPY: drawSleepyEyes(); break;
+    case SLEEPING:
+      updateSleepBubblePhase();
+      drawSleepingEyes();
+      break;
+  }
+}
+
+void faceBenchFrame(int i) {
+  face.eyeOffsetX = face.mouthOffsetX = (i % 17) - 8;
+  face.eyeOffsetY = face.mouthOffsetY = (i % 11) - 5;
+  face.tearFrame = i & 1;
+  face.tearCount = i % 20;
+}
+
+// Programs must draw pixel for pixel what their hand-written twins draw, on
+// every panel, and cost no more than a few percent extra per frame
+int runFaceBench(const char *dir, int frames) {
+  const char *files[] = {"happy", "neutral", "wink", "crying", "sleepy", "sleeping"};
+  std::vector<std::vector<uint8_t>> programs;
+  for (const char *file : files) {
+    std::string path = std::string(dir) + "/" + file + ".face";
+    programs.emplace_back();
+    if (!compileFaceFile(path.c_str(), programs.back())) return 1;
+  }
+
+  bool ok = true;
+  std::vector<FaceValue> code(1024);
+  printf("%-10s %6s %10s %10s %10s %9s\n", "face", "bytes", "mismatch", "us/hand", "us/program", "overhead");
+  for (const std::vector<uint8_t> &program : programs) {
+    int expression = program[3];
+    int mismatches = 0;
+    for (const Panel &panel : benchPanels) {
+      usePanel(panel);
+      bindFaceProgram(program.data(), code.data(), code.size(), code.size());
+      size_t bytes = u8g2.getBufferTileWidth() * u8g2.getBufferTileHeight() * 8;
+      std::vector<uint8_t> expected(bytes);
+      for (int i = 0; i < 64; i++) {
+        faceBenchFrame(i);
+        FaceAnimationState state;
+        state.save();
+        u8g2.clearBuffer();
+        drawBuiltinFace(expression);
+        memcpy(expected.data(), u8g2.getBufferPtr(), bytes);
+        state.restore();
+        u8g2.clearBuffer();
+        runFaceProgram(code.data());
+        if (memcmp(expected.data(), u8g2.getBufferPtr(), bytes) != 0) mismatches++;
+      }
+    }
+
+    // Time on the default panel; best of many rounds, alternating which
+    // renderer goes first so neither always runs on a cold cache
+    usePanel(benchPanels[0]);
+    bindFaceProgram(program.data(), code.data(), code.size(), code.size());
+    double best[2] = {1e30, 1e30};
+    for (int round = 0; round < 20; round++) {
+      for (int pass = 0; pass < 2; pass++) {
+        bool interpreted = (round + pass) % 2;
+        FaceAnimationState state;
+        state.save();
+        double start = nowMicros();
+        for (int i = 0; i < frames; i++) {
+          faceBenchFrame(i);
+          u8g2.clearBuffer();
+          if (interpreted) {
+            runFaceProgram(code.data());
+          } else {
+            drawBuiltinFace(expression);
+          }
+        }
+        best[interpreted] = min(best[interpreted], (nowMicros() - start) / frames);
+        state.restore();
+      }
+    }
+    double hand = best[0];
+    double interpreted = best[1];
+    printf("%-10s %6zu %10d %10.2f %10.2f %8.1f%%\n", expressionNames[expression], program.size(), mismatches, hand,
+           interpreted, 100.0 * (interpreted - hand) / hand);
+    ok = ok && mismatches == 0;
+  }
+  faceBenchFrame(0);
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *mode = argc > 1 ? argv[1] : "bench";
+  setup();
+  int frames = argc > 2 ? atoi(argv[2]) : 2000;
+  if (strcmp(mode, "bench") == 0) {
+    return runBench(frames);
+  }
+  if (strcmp(mode, "strokes") == 0) {
+    return runStrokeBench(frames);
+  }
+  if (strcmp(mode, "gray") == 0) {
+    return runGrayBench(frames);
+  }
+  if (strcmp(mode, "bus") == 0) {
+    return runBusBench(frames);
+  }
+  if (strcmp(mode, "dither") == 0) {
+    double seconds = argc > 2 ? atof(argv[2]) : 60.0;
+    uint32_t seed = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1;
+    return runDitherBench(seconds, seed);
+  }
+  if (strcmp(mode, "sim") == 0) {
+    double hours = argc > 2 ? atof(argv[2]) : 1.0;
+    uint32_t seed = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1;
+    bool trace = argc > 4 && strcmp(argv[4], "trace") == 0;
+    return runSim(hours, seed, trace);
+  }
+  if (strcmp(mode, "tasks") == 0) {
+    double seconds = argc > 2 ? atof(argv[2]) : 0.0;
+    uint32_t seed = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1;
+    return runTasks(seconds, seed);
+  }
+  if (strcmp(mode, "profile") == 0) {
+#ifdef PROFILE
+    double seconds = argc > 2 ? atof(argv[2]) : 60.0;
+    uint32_t seed = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1;
+    return runProfile(seconds, seed);
+#else
+    fprintf(stderr, "profile: rebuild with -DPROFILE\n");
+    return 2;
+#endif
+  }
+  if (strcmp(mode, "ram") == 0) {
+    return runRam(argc > 2 ? argv[2] : nullptr);
+  }
+  if (strcmp(mode, "report") == 0) {
+    return runReport();
+  }
+  if (strcmp(mode, "facec") == 0) {
+    return runFaceCompiler(argc - 2, argv + 2);
+  }
+  if (strcmp(mode, "faces") == 0) {
+    return runFaceBench(argc > 2 ? argv[2] : "faces", 2000);
+  }
+  fprintf(stderr, "usage: %s [bench|strokes|gray|bus [frames]] | sim [hours] [seed] [trace] | report\n"
+                  "       %s tasks|dither|profile [seconds] [seed]\n"
+                  "       %s ram [file.su]\n"
+                  "       %s facec [-b] [file.face...] | faces [dir]\n", argv[0], argv[0], argv[0], argv[0]);
+  return 2;
+}
@@ -1,16 +1,130 @@
 #include <U8g2lib.h>
 #include <Wire.h>
+#if defined(PANEL_SSD1322_256X64) && !defined(BUS_SPI)
+#define BUS_SPI  // The SSD1322 is only wired up on SPI
+#endif
+#if defined(BUS_SPI) && !defined(HOST_BUILD)
+#include <SPI.h>
+#endif
+#if defined(ESP32)
+#include <esp_sleep.h>
+#endif
+#if defined(FACE_FILES)
+#include <LittleFS.h>
+#endif
+#include "faces.h"
 
+// SPI panels share these pins
+const uint8_t busCsPin = 15;
+const uint8_t busDcPin = 16;
+const uint8_t busResetPin = 17;
+
+// Controllers differ in how frames are addressed; see busSendPart()
+enum PanelController : uint8_t { CONTROLLER_SSD1306, CONTROLLER_SH1107, CONTROLLER_SSD1322 };
+
+// Pick the panel at build time; the face layout adapts to its resolution.
+// The 128-wide panels use I2C unless BUS_SPI is defined.
+// 256-pixel-wide panels need U8G2_16BIT enabled in u8g2.h.
+#if defined(PANEL_SH1107_128X128)
+#if defined(BUS_SPI)
+// 128x128 OLED on hardware SPI
+U8G2_SH1107_128X128_F_4W_HW_SPI u8g2(U8G2_R0, /* cs=*/ busCsPin, /* dc=*/ busDcPin, /* reset=*/ busResetPin);
+#else
+// 128x128 OLED on I2C pins (GPIO 4, 5)
+U8G2_SH1107_128X128_F_HW_I2C u8g2(U8G2_R0, /* reset=*/ U8X8_PIN_NONE, /* clock=*/4, /* data=*/5);
+#endif
+#define PANEL_CONTROLLER CONTROLLER_SH1107
+#elif defined(PANEL_SSD1322_256X64)
+// 256x64 OLED on hardware SPI
+U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI u8g2(U8G2_R0, /* cs=*/ busCsPin, /* dc=*/ busDcPin, /* reset=*/ busResetPin);
+#define PANEL_CONTROLLER CONTROLLER_SSD1322
+#else
+#if defined(BUS_SPI)
+// 128x64 OLED on hardware SPI
+U8G2_SSD1306_128X64_NONAME_F_4W_HW_SPI u8g2(U8G2_R0, /* cs=*/ busCsPin, /* dc=*/ busDcPin, /* reset=*/ busResetPin);
+#else
 // Create a U8G2 object for your 128x64 OLED, using I2C pins (GPIO 4, 5)
 U8G2_SSD1306_128X64_NONAME_F_HW_I2C u8g2(U8G2_R0, /* reset=*/ U8X8_PIN_NONE, /* clock=*/4, /* data=*/5);
+#endif
+#define PANEL_CONTROLLER CONTROLLER_SSD1306
+#endif
+
+// Host builds switch panels at run time
+#if defined(HOST_BUILD)
+PanelController panelController = PANEL_CONTROLLER;
+#else
+const PanelController panelController = PANEL_CONTROLLER;
+#endif
+
+// Display bus
+// Frames go to the panel through displayBus rather than U8g2's sendBuffer();
+// U8g2 still initializes the panel and sets contrast and power save. Every
+// backend moves as much as it can per transaction: on I2C, one control byte
+// and a full Wire buffer (U8g2 itself sends 24 data bytes at a time); on SPI,
+// a whole run of commands or data under one chip select. Host builds decode
+// the stream into a model of display RAM instead.
+#ifndef BUS_I2C_HZ
+#define BUS_I2C_HZ 400000  // 1000000 for Fast-mode Plus panels and wiring
+#endif
+#ifndef BUS_SPI_HZ
+#define BUS_SPI_HZ 8000000
+#endif
+
+struct DisplayBus {
+  const char *name;
+  uint32_t clockHz;
+  uint16_t maxTransfer;  // Most bytes one transaction can carry
+  void (*transfer)(bool data, const uint8_t *bytes, uint16_t count);
+};
+
+const uint8_t i2cAddress = 0x3C;
+#if defined(I2C_BUFFER_LENGTH)
+const uint16_t i2cMaxTransfer = I2C_BUFFER_LENGTH - 1;  // Less the control byte
+#elif defined(BUFFER_LENGTH)
+const uint16_t i2cMaxTransfer = BUFFER_LENGTH - 1;
+#else
+const uint16_t i2cMaxTransfer = 31;
+#endif
 
-unsigned long lastBlinkTime = 0;
-bool isBlinking = false;
-int blinkDuration = 150; 
-int blinkInterval = 4000; 
+void i2cBusTransfer(bool data, const uint8_t *bytes, uint16_t count);
+void spiBusTransfer(bool data, const uint8_t *bytes, uint16_t count);
+void hostBusTransfer(bool data, const uint8_t *bytes, uint16_t count);
+
+#if defined(HOST_BUILD)
+DisplayBus displayBus = {"host", 0, 0xFFFF, hostBusTransfer};
+#elif defined(BUS_SPI)
+const DisplayBus displayBus = {"spi", BUS_SPI_HZ, 0xFFFF, spiBusTransfer};
+#else
+const DisplayBus displayBus = {"i2c", BUS_I2C_HZ, i2cMaxTransfer, i2cBusTransfer};
+#endif
+unsigned long framesSent = 0;
+
+// GRAY4 renders 16-level anti-aliased frames on the SSD1322 instead of
+// U8g2's 1-bit buffer. DITHER renders the same way on the SSD1306 and shows
+// the frame as shades by temporal dithering. Host builds can flip between
+// the 1-bit and gray paths at run time.
+#if defined(GRAY4)
+#if !defined(PANEL_SSD1322_256X64)
+#error "GRAY4 needs PANEL_SSD1322_256X64"
+#endif
+const bool grayscale = true;
+#elif defined(DITHER)
+#if defined(PANEL_SH1107_128X128) || defined(PANEL_SSD1322_256X64)
+#error "DITHER needs the SSD1306 panel"
+#endif
+const bool grayscale = true;
+#elif defined(HOST_BUILD)
+bool grayscale = false;
+#else
+const bool grayscale = false;
+#endif
+
+// Blinks and tear steps always take this long
+const uint16_t blinkDuration = 150;
+const uint16_t tearUpdateInterval = 150;
 
 // Track current expression
-enum EyeExpression {
+enum EyeExpression : uint8_t {
   HAPPY,
   SAD,
   NEUTRAL,
@@ -22,202 +136,2023 @@ enum EyeExpression {
   SLEEPING
 };
 
-// Idle animation states
-int eyeOffsetX = 0;  // For eye movement
-int eyeOffsetY = 0;
-unsigned long lastEyeMoveTime = 0;
-int eyeMoveInterval = 1500;  // Change eye position every 1.5 seconds
-
-// Mouth animation
-int mouthOffsetX = 0;  // Mouth position offsets
-int mouthOffsetY = 0;
-unsigned long lastMouthMoveTime = 0;
-int mouthMoveInterval = 2000;  // Change mouth position every 2 seconds
-
-// Tear animation variables
-unsigned long lastTearUpdateTime = 0;
-int tearUpdateInterval = 150;
-int tearFrame = 0;  // For alternating tear animation
-int tearCount = 0;  // To track tear animation cycles
-
-EyeExpression currentExpression = HAPPY;
-unsigned long lastExpressionChange = 0;
-int expressionDuration = 5000; // Change expression every 5 seconds
-
-float sleepBubblePhase = 0.0f;
-float bubbleLifecycles[3] = {0.0f, 2.1f, 4.2f}; // Start at different phases
-bool bubbleActive[3] = {true, true, true};
-const float MAX_LIFECYCLE = 6.28f;
+// Face state
+// Everything that animates a face lives in one packed struct. Timer stamps
+// keep the low 16 bits of faceClock(); differences still come out right as
+// long as a timer is looked at within 65 s of its stamp, and every interval
+// here is far shorter (dwell times are capped at maxExpressionDwell). Phases
+// are fixed point: the sleep phase is a binary angle, 65536 to a full turn,
+// and bubble lifecycles count tenths. The struct is about a quarter the size
+// of the separate int and float globals it replaces, so several faces fit in
+// the RAM one used to take.
+typedef uint16_t FaceStamp;
+
+const int bubbleCount = 3;
+const uint8_t bubbleLifecycleSteps = 63;   // Tenths; a bubble restarts once it reaches 6.28
+const float MAX_LIFECYCLE = 6.28f;
+const uint16_t sleepPhaseStep = 522;       // 0.05 rad
+const uint16_t maxExpressionDwell = 60000;
+
+struct FaceState {
+  FaceStamp lastBlinkTime;
+  FaceStamp lastEyeMoveTime;
+  FaceStamp lastTearUpdateTime;
+  FaceStamp lastExpressionChange;
+  uint16_t blinkInterval;
+  uint16_t eyeMoveInterval;
+  uint16_t expressionDuration;
+  uint16_t sleepBubblePhase;              // Z drift and breathing
+  int8_t eyeOffsetX, eyeOffsetY;          // For eye movement
+  int8_t mouthOffsetX, mouthOffsetY;      // The mouth moves with the eyes
+  EyeExpression currentExpression;
+  uint8_t tearCount;                      // How far the tears have fallen, 0-19
+  uint8_t bubbleLifecycles[bubbleCount];  // Tenths, up to bubbleLifecycleSteps
+  uint8_t bubbleActive : bubbleCount;     // One bit per bubble
+  uint8_t isBlinking : 1;
+  uint8_t tearFrame : 1;                  // For alternating tear animation
+  uint8_t dirty : 1;                      // Frame needs to be rendered and sent
+};
+static_assert(sizeof(FaceState) <= 28, "FaceState should stay small enough to keep several faces in RAM");
+
+FaceState face = {
+  0, 0, 0, 0,
+  4000, 1500, 5000,   // First blink, eye move and expression change
+  0,
+  0, 0, 0, 0,
+  HAPPY,
+  0,
+  {0, 21, 42},        // Bubbles start at different phases
+  0x7, false, 0, true,
+};
+
+// Clock, sleep and random numbers
+// The animation reads time, sleeps and rolls dice only through these, so a
+// host simulation can swap in a virtual clock and a fixed seed and run the
+// state machine deterministically, far faster than real time. Timestamps are
+// 32-bit like millis() on the device, so wrap-around behaves the same on a
+// 64-bit host. faceMicros() is the task scheduler's finer clock.
+uint32_t platformClock();
+uint32_t platformMicros();
+void platformSleep(uint32_t ms);
+uint32_t (*faceClock)() = platformClock;
+uint32_t (*faceMicros)() = platformMicros;
+void (*faceSleep)(uint32_t ms) = platformSleep;
+uint32_t faceRandomState = 0x9E3779B9UL; // xorshift32 state, never zero
+
+// Power management
+// Between animation events most faces are completely static, so instead of
+// redrawing every 30 ms we only render when something changed and sleep the
+// MCU until the next blink, eye move, tear or expression timer is due.
+const int frameInterval = 30;         // Frame period while something is animating
+const uint32_t maxIdleSleep = 1000;    // Upper bound on a single idle sleep
+#ifndef BLANK_WHILE_SLEEPING
+#define BLANK_WHILE_SLEEPING 0  // 1 turns the panel off (setPowerSave) during SLEEPING
+#endif
+const bool blankWhileSleeping = BLANK_WHILE_SLEEPING;
+
+// Panel contrast per mood; OLED current scales with it
+const uint8_t contrastAwake = 255;
+const uint8_t contrastSleepy = 96;
+const uint8_t contrastSleeping = 24;
+
+// Rough supply currents (mA) used for the energy estimate. Tune per board.
+const float mcuActiveMilliamps = 40.0f;
+const float mcuLightSleepMilliamps = 1.0f;
+const float panelBaseMilliamps = 0.5f;     // Controller + charge pump, display on
+const float panelFullLitMilliamps = 25.0f; // Every pixel lit at full contrast
+
+const int expressionCount = SLEEPING + 1;
+
+struct PowerStats {
+  unsigned long awakeMs;   // Time spent updating, rendering and sending
+  unsigned long asleepMs;  // Time spent in light sleep / delay
+  float chargeMilliampMs;  // Integrated supply current (mA * ms)
+};
+PowerStats powerStats[expressionCount];
+
+uint8_t panelContrast = contrastAwake;
+bool panelPowerSave = false;
+float panelLitFraction = 0.0f; // Share of lit pixels in the last sent frame
+
+// Hot-path profiler
+// Build with -DPROFILE to time each phase of loop() with the CPU cycle counter
+// (micros() on boards without one). Samples go into log-linear histograms per
+// expression, with blinks in a slot of their own, and every
+// profileReportInterval the histograms are printed over serial as CSV and
+// cleared. `fredrick-host report` turns the dumps into min/avg/p99 tables.
+// The histograms take about 15 KB of RAM, so this is for ESP32-class boards.
+// Without -DPROFILE the PROFILE_* macros compile to nothing.
+enum ProfilePhase : uint8_t {
+  PHASE_UPDATE,  // Timer and state updates at the top of loop()
+  PHASE_CLEAR,   // clearBuffer()
+  PHASE_DRAW,    // The draw*Eyes() call for the expression
+  PHASE_BUBBLE,  // drawSleepBubble(), also counted in PHASE_DRAW
+  PHASE_SEND,    // sendBuffer()
+  PHASE_FRAME,   // Clear, draw and send together
+  PROFILE_PHASES
+};
+
+const int profileSlots = expressionCount + 1;   // Every expression, then blinks
+const int profileBlinkSlot = expressionCount;
+const int profileBuckets = 124;  // Four buckets per power of two covers 32 bits
+
+#ifdef PROFILE
+const uint32_t profileReportInterval = 10000;  // Keeps the 32-bit sums from overflowing
+
+struct ProfileHistogram {
+  uint32_t count;
+  uint32_t minTicks;
+  uint32_t maxTicks;
+  uint32_t sumTicks;
+  uint16_t buckets[profileBuckets];
+};
+ProfileHistogram profileHistograms[profileSlots][PROFILE_PHASES];
+uint32_t profileLastReport = 0;
+uint16_t profileSequence = 0;
+
+uint32_t profilePending[PROFILE_PHASES];  // Phases that are split across task yields
+
+#define PROFILE_BEGIN(phase) uint32_t profileStart##phase = profileCycles()
+#define PROFILE_END(phase) profileRecord(phase, profileCycles() - profileStart##phase)
+#define PROFILE_ADD(phase) (profilePending[phase] += profileCycles() - profileStart##phase)
+#define PROFILE_FLUSH(phase) (profileRecord(phase, profilePending[phase]), profilePending[phase] = 0)
+#else
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#define PROFILE_ADD(phase)
+#define PROFILE_FLUSH(phase)
+#endif
+
+// Cooperative tasks
+// loop() is a small earliest-deadline-first scheduler over stackless
+// coroutines, so one long frame no longer holds everything else up. A task
+// is a function that carries on from where it last yielded (the resume point
+// is a line number, protothread style) and returns at its next TASK_* macro.
+// Locals do not survive a yield; whatever a task keeps goes in a global.
+// Rendering yields after clearing, after drawing and after every bus
+// transaction of the send, so a sensor or serial task waits at most one of
+// those. When no task is due the MCU light-sleeps until the earliest
+// deadline. Build with -DTASK_STATS to print per-task latency over serial.
+struct Task {
+  const char *name;
+  void (*run)(Task &task);
+  uint16_t resume;  // Line of the last yield, 0 at the start
+  bool waiting;     // Parked in TASK_WAIT_UNTIL until taskWake()
+  uint32_t due;     // faceMicros() time the task wants to run at
+  // Since the last report: how late the task got to run after 'due', and
+  // the longest it ran before yielding
+  uint32_t runs;
+  uint32_t lateSumMicros;
+  uint32_t lateMaxMicros;
+  uint32_t stepMaxMicros;
+};
+
+const int maxTasks = 6;
+Task tasks[maxTasks];  // Earlier tasks win ties
+int taskCount = 0;
+Task *renderTask = nullptr;
+#if defined(DITHER) || defined(HOST_BUILD)
+Task *ditherTask = nullptr;
+#endif
+uint32_t taskAwakeSince = 0;  // faceClock() when the MCU last woke up
+uint32_t renderFrameDue = 0;  // When the frame being rendered was due
+bool renderSendDone = false;
+uint16_t sendOffset = 0;      // Bytes of the frame buffer sent so far
+
+#ifdef TASK_STATS
+const uint32_t taskReportInterval = 10000;
+#endif
+
+#define TASK_BEGIN(task) switch ((task).resume) { case 0:
+#define TASK_END(task) } (task).resume = 0
+// Run again once faceMicros() reaches 'at' (straight away if it has passed)
+#define TASK_SLEEP_UNTIL(task, at) \
+  do { (task).resume = __LINE__; taskSleepUntil(task, at); return; case __LINE__:; } while (0)
+#define TASK_SLEEP(task, ms) TASK_SLEEP_UNTIL(task, faceMicros() + (ms) * 1000UL)
+// Let any other task that is due run first
+#define TASK_YIELD(task) TASK_SLEEP_UNTIL(task, faceMicros())
+// Park until taskWake() finds 'condition' true. The first check falls
+// through into the resume point.
+#define TASK_WAIT_UNTIL(task, condition) \
+  do { (task).resume = __LINE__; [[fallthrough]]; case __LINE__: if (!(condition)) { (task).waiting = true; return; } } while (0)
+
+// Face geometry
+// Every dimension of the face is given in normalized units and resolved to
+// pixels once in setup() for the panel the sketch was built for. X positions
+// are in 1/128ths of the panel width and Y positions in 1/64ths of its
+// height; sizes are in 1/64ths of the face scale (the smaller of half the
+// width and the full height), so features keep their proportions while the
+// face spreads out to fill 128x128 or 256x64 panels.
+// Pixel-level touches (1 px fringes, tear zigzags) stay in plain pixels.
+enum LayoutAxis : uint8_t { AXIS_X, AXIS_Y, AXIS_SIZE };
+
+enum LayoutSlot {
+  // Feature positions
+  LEFT_EYE_X, RIGHT_EYE_X, FACE_CENTER_X, BUBBLE_X,
+  EYE_Y, EYE_LOW_Y, EYE_TOP_Y, MOUTH_Y, MOUTH_LOW_Y, SURPRISED_MOUTH_DROP,
+  EYE_RANGE_X, EYE_RANGE_Y,
+  // Eyes and lids
+  EYE_WIDTH, EYE_HEIGHT, SAD_EYE_HALF, SAD_EYE_DEPTH, EYE_SLANT,
+  ANGRY_EYE_WIDTH, ANGRY_EYE_HEIGHT, ANGRY_EYE_CURVE,
+  LID_HALF, LID_RISE, WINK_EYE_DEPTH, WINK_EYE_LIFT,
+  // Mouths
+  MOUTH_HALF, SMILE_DEPTH, SAD_MOUTH_HALF, SAD_MOUTH_DEPTH,
+  SLEEPY_MOUTH_HALF, SLEEPY_MOUTH_END, SLEEPING_MOUTH_HALF,
+  WINK_MOUTH_HALF, WINK_MOUTH_DEPTH,
+  ANGRY_MOUTH_WIDTH, ANGRY_MOUTH_HEIGHT, TOOTH_SPACING,
+  SURPRISED_MOUTH_WIDTH, SURPRISED_MOUTH_HEIGHT,
+  // Strokes, tears and sleep bubbles
+  STROKE_THIN, STROKE_BOLD, TEAR_LENGTH,
+  BUBBLE_DROP, BUBBLE_RISE_X2, Z_SIZE,
+  BUBBLE_SIZE_0, BUBBLE_SIZE_1, BUBBLE_SIZE_2,
+  BUBBLE_DX_0, BUBBLE_DX_1, BUBBLE_DX_2,
+  BUBBLE_DY_0, BUBBLE_DY_1, BUBBLE_DY_2,
+  LAYOUT_SLOTS
+};
+
+struct LayoutSpec {
+  LayoutAxis axis;
+  int8_t value;
+};
+
+// Indexed by LayoutSlot. Values are the familiar 128x64 pixel numbers.
+const LayoutSpec layoutSpec[LAYOUT_SLOTS] = {
+  {AXIS_X, 35}, {AXIS_X, 93}, {AXIS_X, 64}, {AXIS_X, 68},
+  {AXIS_Y, 24}, {AXIS_Y, 28}, {AXIS_Y, 20}, {AXIS_Y, 52}, {AXIS_Y, 54}, {AXIS_Y, 30},
+  {AXIS_X, 8}, {AXIS_Y, 5},
+  {AXIS_SIZE, 14}, {AXIS_SIZE, 20}, {AXIS_SIZE, 8}, {AXIS_SIZE, 6}, {AXIS_SIZE, 4},
+  {AXIS_SIZE, 20}, {AXIS_SIZE, 12}, {AXIS_SIZE, 4},
+  {AXIS_SIZE, 7}, {AXIS_SIZE, 2}, {AXIS_SIZE, 3}, {AXIS_SIZE, 1},
+  {AXIS_SIZE, 10}, {AXIS_SIZE, 6}, {AXIS_SIZE, 12}, {AXIS_SIZE, 4},
+  {AXIS_SIZE, 7}, {AXIS_SIZE, 5}, {AXIS_SIZE, 5},
+  {AXIS_SIZE, 15}, {AXIS_SIZE, 3},
+  {AXIS_SIZE, 24}, {AXIS_SIZE, 6}, {AXIS_SIZE, 5},
+  {AXIS_SIZE, 20}, {AXIS_SIZE, 10},
+  {AXIS_SIZE, 1}, {AXIS_SIZE, 2}, {AXIS_SIZE, 18},
+  {AXIS_SIZE, 10}, {AXIS_SIZE, 5}, {AXIS_SIZE, 4},
+  {AXIS_SIZE, 2}, {AXIS_SIZE, 3}, {AXIS_SIZE, 5},
+  {AXIS_SIZE, 2}, {AXIS_SIZE, 8}, {AXIS_SIZE, 16},
+  {AXIS_SIZE, -2}, {AXIS_SIZE, -5}, {AXIS_SIZE, -10},
+};
+
+// Resolved pixel values, filled in by resolveLayout()
+int16_t layout[LAYOUT_SLOTS];
+
+// Face programs
+// An expression can be described as data instead of a drawXxxEyes() function:
+// a short byte program, compiled on the host from a text file in faces/ with
+// `fredrick-host facec`, that runFaceProgram() streams straight into the
+// stroke engine. Programs live in flash (faces.h) and, with -DFACE_FILES on
+// ESP32, can be replaced from /faces/*.bin on LittleFS without reflashing.
+//
+// Layout, little-endian:
+//   'F' 'X' version expression flags dwellMin(2) dwellMax(2) size(2)
+//   then ops, each an opcode byte and a fixed number of operands, then OP_END.
+// An operand is a count byte followed by that many terms that are summed:
+// a constant, a layout slot, a live variable (eye offset, breathing, tear
+// frame), or a layout slot times num/den; at most two terms may be variables.
+// Everything else is drawn by the existing primitives, so a program renders
+// exactly like its hand-written twin.
+//
+// Layout slots only change in resolveLayout(), so installed programs are
+// bound once per layout into FaceValues in RAM: the constant part of every
+// operand is folded ahead of time and a frame only adds the live variables.
+// Shapes that the variables only move are also drawn once while binding and
+// kept as spans, so a 1-bit frame replays them with one fillSpan() per row.
+const uint8_t faceVersion = 2;  // 2: OP_LIDDED gained lidInk
+const int faceHeaderSize = 11;
+
+enum FaceFlags : uint8_t {
+  FACE_ANIMATES = 1,  // Redraw every frame, not just on events
+  FACE_NO_BLINK = 2,  // Blinks do not replace the face
+};
+
+enum FaceOp : uint8_t {
+  OP_END,
+  OP_OVAL,     // cx cy width height
+  OP_LIDDED,   // cx cy width height cutY lidInk
+  OP_LINE,     // x0 y0 x1 y1 width
+  OP_QUAD,     // x0 y0 x1 y1 x2 y2 width
+  OP_ADVANCE,  // Step the sleep animation phase; once per frame
+  OP_BUBBLES,  // x y: sleep bubble and Z emitter
+  OP_TEARS,    // x y frame offset: falling tear emitter
+  FACE_OPS
+};
+
+const uint8_t faceOperandCounts[FACE_OPS] = {0, 4, 6, 5, 7, 0, 2, 4};
+
+// Operands that place a shape rather than size it, as bit masks over the
+// operand list. A shape whose x operands all move together, whose y operands
+// all move together and whose other operands are constant is the same set of
+// pixels wherever it is, so it can be drawn once at bind time and replayed
+// as spans (1-bit only).
+const uint8_t faceXOperands[FACE_OPS] = {0, 0x01, 0x01, 0x05, 0x15, 0, 0, 0};
+const uint8_t faceYOperands[FACE_OPS] = {0, 0x02, 0x12, 0x0A, 0x2A, 0, 0, 0};
+
+enum FaceTerm : uint8_t {
+  TERM_CONST,        // int8
+  TERM_SLOT,         // slot
+  TERM_SLOT_NEG,     // slot
+  TERM_VAR,          // variable
+  TERM_VAR_NEG,      // variable
+  TERM_SLOT_SCALED,  // slot, int8 num, uint8 den
+  FACE_TERMS
+};
+
+enum FaceVar : uint8_t {
+  VAR_EYE_X, VAR_EYE_Y, VAR_MOUTH_X, VAR_MOUTH_Y,
+  VAR_BREATH,    // -1 or 0 with the sleep phase
+  VAR_TEAR,      // face.tearFrame
+  VAR_TEAR_ALT,  // !face.tearFrame
+  FACE_VARS
+};
+
+// A bound operand: base plus two entries of the per-frame variable table
+// (index 0 is zero, then +var and -var for each FaceVar). An opcode takes a
+// whole FaceValue of its own, in 'base', with varA set if its operands need
+// the breathing offset (a sin() call, so it is only worked out on demand)
+// and varB set if its spans follow the operands: a count in 'base', then
+// one FaceValue per span with x0 in 'base', y in varA and length - 1 in varB,
+// as drawn with every variable at zero.
+struct FaceValue {
+  int16_t base;
+  uint8_t varA;
+  uint8_t varB;
+};
+const int faceVarTableSize = 1 + 2 * FACE_VARS;
+
+// Program per expression, or nullptr for the built-in drawing function
+const uint8_t *facePrograms[expressionCount];
+
+// Bound programs share one pool; a program that does not fit is not used
+const int faceCodeCapacity = 128;
+FaceValue faceCode[faceCodeCapacity];
+int16_t faceCodeStart[expressionCount];  // Index into faceCode, or -1
+
+// Stroke engine
+// A run that has been walked but not emitted yet. Runs that continue it on
+// the same row or column are merged in first, so a curve made of short
+// chords still goes out as one span per row instead of one per chord.
+struct PendingRun {
+  bool active;
+  bool xMajor;
+  int from;   // from <= to
+  int to;
+  int minor;
+};
+
+// Forward declarations, so the sketch also builds as plain C++
+Task *taskAdd(const char *name, void (*run)(Task &task));
+void taskSleepUntil(Task &task, uint32_t at);
+void taskWake(Task &task);
+void taskRunNext();
+void taskReport();
+void runFaceTask(Task &task);
+void runRenderTask(Task &task);
+void runDitherTask(Task &task);
+#ifdef TASK_STATS
+void runStatsTask(Task &task);
+#endif
+void updateFace(uint32_t currentMillis);
+bool faceAnimating();
+void clearFrame();
+bool sendFramePart();
+void sendFrame();
+void busWrite(bool data, const uint8_t *bytes, size_t count);
+bool busSendPart();
+void drawFace();
+uint32_t timeUntilDue(FaceStamp now, FaceStamp since, uint16_t interval);
+uint32_t timeUntilNextEvent(uint32_t now);
+void lightSleep(EyeExpression state, uint32_t awakeMs, uint32_t ms);
+void faceRandomSeed(uint32_t seed);
+uint32_t faceRandomNext();
+long faceRandom(long howbig);
+long faceRandom(long howsmall, long howbig);
+void applyPanelPower();
+float litPixelFraction();
+void accountPower(EyeExpression state, unsigned long awakeMs, unsigned long asleepMs);
+int scaleLayoutValue(int value, int num, int den);
+void resolveLayout(int width, int height);
+#ifdef POWER_STATS
+void reportPowerStats(EyeExpression state);
+#endif
+int profileBucket(uint32_t ticks);
+uint32_t profileBucketFloor(int bucket);
+#ifdef PROFILE
+uint32_t profileCycles();
+uint32_t profileTicksPerMicro();
+void profileRecord(ProfilePhase phase, uint32_t ticks);
+void profileTick(uint32_t now);
+void profileDump();
+#endif
+void grayClearBuffer();
+void grayBlend(int x, int y, uint8_t level);
+void graySpan(int x0, int x1, int y);
+void grayColumnCoverage(int x, int32_t top, int32_t bottom);
+void addCoverageSpan(int32_t left, int32_t right);
+void flushCoverageRow(int y);
+uint32_t isqrt32(uint32_t value);
+void grayFillEllipse(int32_t cx, int32_t cy, int32_t a, int32_t b, int32_t clipTop, int32_t clipBottom);
+void grayStrokeLine(int x0, int y0, int x1, int y1, int width);
+uint32_t grayRowHash(const uint8_t *row);
+void graySendBuffer();
+float grayLitFraction();
+void ditherQuantize();
+void ditherSubframe(uint8_t phase, uint8_t *out);
+bool ditherSendPage(const uint8_t *next, int page);
+bool ditherActive();
+void plotPixel(int x, int y);
+void fillSpan(int x0, int x1, int y);
+void fillColumn(int x, int y0, int y1);
+void strokeRun(bool xMajor, int from, int to, int minor, int width);
+void queueRun(PendingRun &run, bool xMajor, int from, int to, int minor, int width);
+void flushRun(PendingRun &run, int width);
+void walkStrokeLine(PendingRun &run, int x0, int y0, int x1, int y1, int width);
+void drawStrokeLine(int x0, int y0, int x1, int y1, int width);
+void drawStrokeQuad(int x0, int y0, int x1, int y1, int x2, int y2, int width);
+void drawSmoothLine(int x0, int y0, int x1, int y1, float thickness = 1.0);
+void drawSmoothFilledCircle(int x0, int y0, int radius);
+void drawSmoothOval(int centerX, int centerY, int width, int height);
+void drawHappyEyes();
+void drawSadEyes();
+void drawSadMouth(int mouthX, int mouthY);
+void drawLiddedEye(int centerX, int centerY, int eyeWidth, int eyeHeight, int cutY, uint8_t lidInk);
+void drawNeutralEyes();
+void drawSleepyEyes();
+void drawSleepBubble(int centerX, int centerY);
+void updateBubbleLifecycle(int bubbleIndex);
+void updateSleepBubblePhase();
+float sleepPhaseRadians();
+int sleepBreath();
+void drawSleepingEyes();
+void drawWinkEyes();
+void drawAngryEyes();
+void drawSurprisedEyes();
+void drawCryingEyes(int frame);
+void drawBlinkingEyes();
+void drawSmoothThickCircle(int x0, int y0, int radius, float thickness = 1.0);
+void drawThickLine(int x0, int y0, int x1, int y1);
+void drawTear(int centerX, int startY, int frame, int offset);
+uint16_t faceWord(const uint8_t *p);
+bool faceProgramValid(const uint8_t *program, size_t size);
+bool installFaceProgram(const uint8_t *program, size_t size);
+#if defined(FACE_FILES)
+void releaseFaceProgram(const uint8_t *program);
+#endif
+void loadFacePrograms();
+int captureFaceSpans(uint8_t op, const FaceValue *operands, FaceValue *spans, int capacity);
+int bindFaceProgram(const uint8_t *program, FaceValue *code, int capacity, int spanCapacity);
+void bindFacePrograms();
+uint8_t faceFlags(EyeExpression expression);
+int faceDwell(EyeExpression expression);
+void drawFaceOp(uint8_t op, const int *v);
+void runFaceProgram(const FaceValue *code);
+
+void setup() {
+  u8g2.setBusClock(displayBus.clockHz);
+  u8g2.begin();
+  u8g2.setDrawColor(1); // White
+  u8g2.setFont(u8g2_font_helvB12_tr);
+  resolveLayout(u8g2.getDisplayWidth(), u8g2.getDisplayHeight());
+  loadFacePrograms();
+  
+  // Initialize random seed
+  faceRandomSeed(analogRead(0));
+
+#if defined(POWER_STATS) || defined(PROFILE) || defined(TASK_STATS)
+  Serial.begin(115200);
+#endif
+  applyPanelPower();
+
+  taskAdd("face", runFaceTask);
+  renderTask = taskAdd("render", runRenderTask);
+#ifdef DITHER
+  ditherTask = taskAdd("dither", runDitherTask);
+#endif
+#ifdef TASK_STATS
+  taskAdd("stats", runStatsTask);
+#endif
+  taskAwakeSince = faceClock();
+}
+
+void loop() {
+  taskRunNext();
+}
+
+// Register a task, due straight away
+Task *taskAdd(const char *name, void (*run)(Task &task)) {
+  if (taskCount == maxTasks) return nullptr;
+  Task &task = tasks[taskCount++];
+  task = Task();
+  task.name = name;
+  task.run = run;
+  task.due = faceMicros();
+  return &task;
+}
+
+// A deadline that has already passed is not carried over, so a task that
+// overruns its period starts afresh rather than falling further behind
+void taskSleepUntil(Task &task, uint32_t at) {
+  uint32_t now = faceMicros();
+  task.due = (int32_t)(at - now) > 0 ? at : now;
+}
+
+void taskWake(Task &task) {
+  if (task.waiting) {
+    task.waiting = false;
+    task.due = faceMicros();
+  }
+}
+
+// Run one step of the task with the earliest deadline, or sleep until it is due
+void taskRunNext() {
+  Task *next = nullptr;
+  for (int i = 0; i < taskCount; i++) {
+    if (!tasks[i].waiting && (!next || (int32_t)(tasks[i].due - next->due) < 0)) {
+      next = &tasks[i];
+    }
+  }
+  if (!next) return;
+
+  uint32_t start = faceMicros();
+  int32_t wait = next->due - start;
+  if (wait > 0) {
+    lightSleep(face.currentExpression, faceClock() - taskAwakeSince, (wait + 999) / 1000);
+    taskAwakeSince = faceClock();
+    return;
+  }
+
+  next->run(*next);
+  uint32_t step = faceMicros() - start;
+  next->runs++;
+  next->lateSumMicros += -wait;
+  next->lateMaxMicros = max(next->lateMaxMicros, (uint32_t)-wait);
+  next->stepMaxMicros = max(next->stepMaxMicros, step);
+}
+
+// One line per task, then the counters start over:
+//   task,<name>,<runs>,<average late us>,<max late us>,<longest step us>
+// and on ESP32 the loop stack's headroom as stack,<bytes>
+void taskReport() {
+  for (int i = 0; i < taskCount; i++) {
+    Task &task = tasks[i];
+    Serial.print("task,");
+    Serial.print(task.name);
+    Serial.print(',');
+    Serial.print(task.runs);
+    Serial.print(',');
+    Serial.print(task.runs ? task.lateSumMicros / task.runs : 0);
+    Serial.print(',');
+    Serial.print(task.lateMaxMicros);
+    Serial.print(',');
+    Serial.println(task.stepMaxMicros);
+    task.runs = task.lateSumMicros = task.lateMaxMicros = task.stepMaxMicros = 0;
+  }
+#if defined(ESP32)
+  // Bytes of the loop task's stack that have never been touched
+  Serial.print("stack,");
+  Serial.println((unsigned long)uxTaskGetStackHighWaterMark(NULL));
+#endif
+}
+
+// Timers and state changes, then sleep until the next one is due
+void runFaceTask(Task &task) {
+  updateFace(faceClock());
+  if (face.dirty || faceAnimating()) {
+    taskWake(*renderTask);
+  }
+  taskSleepUntil(task, faceMicros() + timeUntilNextEvent(faceClock()) * 1000UL);
+}
+
+// Clear, draw and send a frame whenever the face changed, and every
+// frameInterval while it animates
+void runRenderTask(Task &task) {
+  TASK_BEGIN(task);
+  while (true) {
+    TASK_WAIT_UNTIL(task, face.dirty || faceAnimating());
+    renderFrameDue = task.due;
+    face.dirty = false;  // A change from here on is drawn in the next frame
+    {
+      PROFILE_BEGIN(PHASE_FRAME);
+      clearFrame();
+      PROFILE_ADD(PHASE_FRAME);
+    }
+    TASK_YIELD(task);
+    {
+      PROFILE_BEGIN(PHASE_FRAME);
+      drawFace();
+      PROFILE_ADD(PHASE_FRAME);
+    }
+    TASK_YIELD(task);
+    while (true) {
+      {
+        PROFILE_BEGIN(PHASE_FRAME);
+        renderSendDone = sendFramePart();
+        PROFILE_ADD(PHASE_FRAME);
+      }
+      if (renderSendDone) break;
+      TASK_YIELD(task);
+    }
+    PROFILE_FLUSH(PHASE_FRAME);
+    panelLitFraction = litPixelFraction();
+
+    if (faceAnimating()) {
+      // Keep the bubble cadence
+      TASK_SLEEP_UNTIL(task, renderFrameDue + frameInterval * 1000UL);
+    }
+  }
+  TASK_END(task);
+}
+
+#ifdef TASK_STATS
+void runStatsTask(Task &task) {
+  taskReport();
+  taskSleepUntil(task, task.due + taskReportInterval * 1000UL);
+}
+#endif
+
+// Only SLEEPING animates on every frame (bubbles and Z); everything else is
+// static until one of the timers in updateFace() fires
+bool faceAnimating() {
+  return (faceFlags(face.currentExpression) & FACE_ANIMATES) &&
+         !(face.currentExpression == SLEEPING && blankWhileSleeping);
+}
+
+void updateFace(uint32_t currentMillis) {
+  PROFILE_BEGIN(PHASE_UPDATE);
+  const FaceStamp now = currentMillis;
+
+  // Check if it's time to blink
+  if (!face.isBlinking && (FaceStamp)(now - face.lastBlinkTime) >= face.blinkInterval) {
+    face.isBlinking = true;
+    face.lastBlinkTime = now;
+    face.dirty = true;
+  } 
+  else if (face.isBlinking && (FaceStamp)(now - face.lastBlinkTime) >= blinkDuration) {
+    face.isBlinking = false;
+    face.lastBlinkTime = now;
+    face.dirty = true;
+    // Randomize next blink interval slightly (3-5 seconds)
+    face.blinkInterval = faceRandom(3000, 5000);
+  }
+
+  // Update tear animation
+  if (face.currentExpression == CRYING && (FaceStamp)(now - face.lastTearUpdateTime) >= tearUpdateInterval) {
+    face.tearFrame = !face.tearFrame;  // Toggle between 0 and 1
+    face.lastTearUpdateTime = now;
+    face.dirty = true;
+    face.tearCount++;
+    
+    // After 20 tear frames (about 3 seconds), reset tears position
+    if (face.tearCount >= 20) {
+      face.tearCount = 0;
+    }
+  }
+
+  // Update random eye movements when idle
+  if ((FaceStamp)(now - face.lastEyeMoveTime) >= face.eyeMoveInterval) {
+    // Make eyes look in a wilder random direction
+    face.eyeOffsetX = faceRandom(-layout[EYE_RANGE_X], layout[EYE_RANGE_X] + 1);  // -8 to +8 pixels on 128x64
+    face.eyeOffsetY = faceRandom(-layout[EYE_RANGE_Y], layout[EYE_RANGE_Y] + 1);  // -5 to +5 pixels on 128x64
+
+    // Move mouth exactly the same as eyes
+    face.mouthOffsetX = face.eyeOffsetX;
+    face.mouthOffsetY = face.eyeOffsetY;
+
+    face.lastEyeMoveTime = now;
+    face.dirty = true;
+
+    // Randomize next movement interval
+    face.eyeMoveInterval = faceRandom(500, 2500);
+  }
+  
+  // Change expression periodically
+  if ((FaceStamp)(now - face.lastExpressionChange) >= face.expressionDuration) {
+    EyeExpression leaving = face.currentExpression;
+    // Cycle through expressions including CRYING
+    switch (face.currentExpression) {
+      case HAPPY:
+      case WINK:  // Not in the cycle; only shown when set directly
+        face.currentExpression = SAD;
+        break;
+      case SAD:
+        face.currentExpression = NEUTRAL;
+        break;
+      case NEUTRAL:
+        face.currentExpression = ANGRY;
+        break;
+      case ANGRY:
+        face.currentExpression = SURPRISED;
+        break;
+      case SURPRISED:
+        face.currentExpression = SLEEPY;  // Added CRYING to cycle
+        break;
+      case SLEEPY: 
+        face.currentExpression = SLEEPING; 
+        break;
+      case SLEEPING: 
+        face.currentExpression = CRYING; 
+        break;
+      case CRYING:
+        face.currentExpression = HAPPY;
+        break;
+    }
+    // Time awake so far went to drawing the old face
+    accountPower(leaving, faceClock() - taskAwakeSince, 0);
+    taskAwakeSince = faceClock();
+#ifdef POWER_STATS
+    reportPowerStats(leaving);
+#endif
+    face.lastExpressionChange = now;
+    // Randomize next expression duration (4-7 seconds unless the face says otherwise)
+    face.expressionDuration = faceDwell(face.currentExpression);
+    face.dirty = true;
+    // The tear stamp goes stale while not crying; start the tears straight away
+    if (face.currentExpression == CRYING) {
+      face.lastTearUpdateTime = now - tearUpdateInterval;
+    }
+    applyPanelPower();
+  }
+  PROFILE_END(PHASE_UPDATE);
+#ifdef PROFILE
+  profileTick(currentMillis);
+#endif
+}
+
+void clearFrame() {
+  PROFILE_BEGIN(PHASE_CLEAR);
+  if (grayscale) {
+    grayClearBuffer();
+  } else {
+    u8g2.clearBuffer();
+  }
+  PROFILE_END(PHASE_CLEAR);
+}
+
+// Send the next piece of the frame, at most one bus transaction's worth on
+// the 128-wide panels. Returns true once the whole frame is out. A dithered
+// frame only has to be handed over to the dither task.
+bool sendFramePart() {
+  PROFILE_BEGIN(PHASE_SEND);
+  bool done = true;
+  if (grayscale && panelController == CONTROLLER_SSD1306) {
+    ditherQuantize();  // The dither task puts it on the panel
+  } else if (grayscale) {
+    graySendBuffer();
+  } else if (panelController == CONTROLLER_SSD1322) {
+    u8g2.sendBuffer();  // U8g2 widens 1-bit frames to the SSD1322's 4 bits
+  } else {
+    done = busSendPart();
+  }
+  PROFILE_ADD(PHASE_SEND);
+  if (done) {
+    framesSent++;
+    PROFILE_FLUSH(PHASE_SEND);
+  }
+  return done;
+}
+
+void sendFrame() {
+  while (!sendFramePart()) {
+  }
+}
+
+// Split a run of commands or data into as few transactions as the bus allows
+void busWrite(bool data, const uint8_t *bytes, size_t count) {
+  while (count > 0) {
+    uint16_t chunk = min(count, (size_t)displayBus.maxTransfer);
+    displayBus.transfer(data, bytes, chunk);
+    bytes += chunk;
+    count -= chunk;
+  }
+}
+
+// Send the next part of U8g2's frame buffer, whose tile rows are the panel's
+// 8-pixel pages. The SSD1306 takes the whole frame as one stream into a
+// column and page window, so a part is one full transaction of it; the
+// SH1107 has no window, so each page is addressed and sent on its own.
+// Returns true once the frame is complete.
+bool busSendPart() {
+  const uint8_t *buffer = u8g2.getBufferPtr();
+  const int width = u8g2.getBufferTileWidth() * 8;
+  const int pages = u8g2.getBufferTileHeight();
+  const int size = width * pages;
+  if (panelController == CONTROLLER_SSD1306) {
+    if (sendOffset == 0) {
+      const uint8_t window[] = {
+        0x20, 0x00,                          // Horizontal addressing
+        0x21, 0x00, (uint8_t)(width - 1),   // Columns
+        0x22, 0x00, (uint8_t)(pages - 1),   // Pages
+      };
+      busWrite(false, window, sizeof(window));
+    }
+    uint16_t chunk = min(size - sendOffset, (int)displayBus.maxTransfer);
+    busWrite(true, buffer + sendOffset, chunk);
+    sendOffset += chunk;
+  } else {
+    const uint8_t address[] = {(uint8_t)(0xB0 | sendOffset / width), 0x10, 0x00};  // Page, column 0
+    busWrite(false, address, sizeof(address));
+    busWrite(true, buffer + sendOffset, width);
+    sendOffset += width;
+  }
+  if (sendOffset < size) return false;
+  sendOffset = 0;
+  return true;
+}
+
+#if defined(HOST_BUILD)
+void hostBusTransfer(bool data, const uint8_t *bytes, uint16_t count) {
+  u8g2.getU8x8()->transaction(data, bytes, count);
+}
+#elif defined(BUS_SPI)
+// D/C low for commands, high for data (SSD1322 arguments count as data)
+void spiBusTransfer(bool data, const uint8_t *bytes, uint16_t count) {
+  SPI.beginTransaction(SPISettings(displayBus.clockHz, MSBFIRST, SPI_MODE0));
+  digitalWrite(busDcPin, data ? HIGH : LOW);
+  digitalWrite(busCsPin, LOW);
+#if defined(ESP32)
+  SPI.writeBytes(bytes, count);
+#else
+  for (uint16_t i = 0; i < count; i++) {
+    SPI.transfer(bytes[i]);
+  }
+#endif
+  digitalWrite(busCsPin, HIGH);
+  SPI.endTransaction();
+}
+#else
+// The control byte says whether the rest of the transaction is commands or data
+void i2cBusTransfer(bool data, const uint8_t *bytes, uint16_t count) {
+  Wire.beginTransmission(i2cAddress);
+  Wire.write(data ? 0x40 : 0x00);
+  Wire.write(bytes, count);
+  Wire.endTransmission();
+}
+#endif
+
+// Draw the current expression (or a blink) into the frame buffer
+void drawFace() {
+  PROFILE_BEGIN(PHASE_DRAW);
+  if (face.isBlinking && !(faceFlags(face.currentExpression) & FACE_NO_BLINK)) {
+    drawBlinkingEyes();
+  } else if (faceCodeStart[face.currentExpression] >= 0) {
+    runFaceProgram(&faceCode[faceCodeStart[face.currentExpression]]);
+  } else {
+    // Draw the current expression
+    switch (face.currentExpression) {
+      case HAPPY:
+        drawHappyEyes();
+        break;
+      case SAD:
+        drawSadEyes();
+        break;
+      case NEUTRAL:
+        drawNeutralEyes();
+        break;
+      case WINK:
+        drawWinkEyes();
+        break;
+      case ANGRY:
+        drawAngryEyes();
+        break;
+      case SURPRISED:
+        drawSurprisedEyes();
+        break;
+      case CRYING:
+        drawCryingEyes(face.tearFrame);
+        break;
+      case SLEEPY: 
+        drawSleepyEyes();
+        break;
+      case SLEEPING:
+        updateSleepBubblePhase();  
+        drawSleepingEyes();
+        break;
+    }
+  }
+  PROFILE_END(PHASE_DRAW);
+}
+
+// Milliseconds until a timer started at 'since' with period 'interval' is due
+uint32_t timeUntilDue(FaceStamp now, FaceStamp since, uint16_t interval) {
+  FaceStamp elapsed = now - since;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+// Milliseconds until the next blink, eye move, tear or expression event
+uint32_t timeUntilNextEvent(uint32_t now) {
+  uint32_t wait = timeUntilDue(now, face.lastBlinkTime, face.isBlinking ? blinkDuration : face.blinkInterval);
+  wait = min(wait, timeUntilDue(now, face.lastEyeMoveTime, face.eyeMoveInterval));
+  wait = min(wait, timeUntilDue(now, face.lastExpressionChange, face.expressionDuration));
+  if (face.currentExpression == CRYING) {
+    wait = min(wait, timeUntilDue(now, face.lastTearUpdateTime, tearUpdateInterval));
+  }
+  return min(wait, maxIdleSleep);
+}
+
+// Sleep the MCU for 'ms' and charge the elapsed time to 'state'
+void lightSleep(EyeExpression state, uint32_t awakeMs, uint32_t ms) {
+  uint32_t sleepStart = faceClock();
+  if (ms > 0) {
+    faceSleep(ms);
+  }
+  accountPower(state, awakeMs, faceClock() - sleepStart);
+}
+
+uint32_t platformClock() {
+  return millis();
+}
+
+uint32_t platformMicros() {
+  return micros();
+}
+
+void platformSleep(uint32_t ms) {
+#if defined(ESP32)
+  // Timer wake-up; RAM, I2C state and millis() survive light sleep
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000ULL);
+  esp_light_sleep_start();
+#else
+  // No portable timed light sleep elsewhere; delay() lets the core idle
+  delay(ms);
+#endif
+}
+
+// Seed the xorshift generator. Zero is a fixed point, so it is remapped.
+void faceRandomSeed(uint32_t seed) {
+  // SplitMix-style scramble so nearby seeds give unrelated sequences
+  seed = (seed ^ (seed >> 16)) * 0x45D9F3BUL;
+  seed = (seed ^ (seed >> 16)) * 0x45D9F3BUL;
+  seed ^= seed >> 16;
+  faceRandomState = seed ? seed : 0x9E3779B9UL;
+}
+
+uint32_t faceRandomNext() {
+  uint32_t x = faceRandomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return faceRandomState = x;
+}
+
+// Same contract as Arduino's random(): a value in [0, howbig)
+long faceRandom(long howbig) {
+  if (howbig <= 0) return 0;
+  return (long)(((uint64_t)faceRandomNext() * (uint32_t)howbig) >> 32);
+}
+
+// A value in [howsmall, howbig)
+long faceRandom(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + faceRandom(howbig - howsmall);
+}
+
+// Dim the panel (or switch it off) to suit the current mood
+void applyPanelPower() {
+  uint8_t contrast = contrastAwake;
+  if (face.currentExpression == SLEEPY) {
+    contrast = contrastSleepy;
+  } else if (face.currentExpression == SLEEPING) {
+    contrast = contrastSleeping;
+  }
+  bool powerSave = blankWhileSleeping && face.currentExpression == SLEEPING;
+
+  if (powerSave != panelPowerSave) {
+    u8g2.setPowerSave(powerSave);
+    panelPowerSave = powerSave;
+  }
+  if (contrast != panelContrast) {
+    u8g2.setContrast(contrast);
+    panelContrast = contrast;
+  }
+}
+
+// Fraction of lit pixels in the frame buffer, for the panel current estimate
+float litPixelFraction() {
+  if (grayscale) {
+    return grayLitFraction();
+  }
+
+  const uint8_t *buf = u8g2.getBufferPtr();
+  int bytes = u8g2.getBufferTileWidth() * u8g2.getBufferTileHeight() * 8;
+  long lit = 0;
+  for (int i = 0; i < bytes; i++) {
+    lit += __builtin_popcount(buf[i]);
+  }
+  return (float)lit / (bytes * 8);
+}
+
+void accountPower(EyeExpression state, unsigned long awakeMs, unsigned long asleepMs) {
+  float panelMilliamps = 0.0f;
+  if (!panelPowerSave) {
+    panelMilliamps = panelBaseMilliamps +
+                     panelFullLitMilliamps * panelLitFraction * panelContrast / 255.0f;
+  }
+
+  PowerStats &stats = powerStats[state];
+  stats.awakeMs += awakeMs;
+  stats.asleepMs += asleepMs;
+  stats.chargeMilliampMs += awakeMs * (mcuActiveMilliamps + panelMilliamps) +
+                            asleepMs * (mcuLightSleepMilliamps + panelMilliamps);
+}
+
+// Scale a normalized value by num/den, rounding half away from zero
+int scaleLayoutValue(int value, int num, int den) {
+  long scaled = (long)value * num;
+  return (scaled + (scaled >= 0 ? den / 2 : -den / 2)) / den;
+}
+
+// Turn the normalized face description into pixels for a width x height panel
+void resolveLayout(int width, int height) {
+  int faceScale = min(width / 2, height);
+  for (int i = 0; i < LAYOUT_SLOTS; i++) {
+    const LayoutSpec &spec = layoutSpec[i];
+    switch (spec.axis) {
+      case AXIS_X:
+        layout[i] = scaleLayoutValue(spec.value, width, 128);
+        break;
+      case AXIS_Y:
+        layout[i] = scaleLayoutValue(spec.value, height, 64);
+        break;
+      case AXIS_SIZE:
+        layout[i] = scaleLayoutValue(spec.value, faceScale, 64);
+        // Never let a feature vanish on a small panel
+        if (layout[i] == 0 && spec.value != 0) {
+          layout[i] = spec.value > 0 ? 1 : -1;
+        }
+        break;
+    }
+  }
+  bindFacePrograms();
+}
+
+#ifdef POWER_STATS
+// Print duty cycle and average current for the state we are leaving
+void reportPowerStats(EyeExpression state) {
+  const PowerStats &stats = powerStats[state];
+  unsigned long total = stats.awakeMs + stats.asleepMs;
+  if (total == 0) return;
+
+  Serial.print("power state=");
+  Serial.print((int)state);
+  Serial.print(" duty=");
+  Serial.print(100.0f * stats.awakeMs / total, 1);
+  Serial.print("% avg_mA=");
+  Serial.print(stats.chargeMilliampMs / total, 2);
+  Serial.print(" mAh=");
+  Serial.println(stats.chargeMilliampMs / 3600000.0f, 4);
+}
+#endif
+
+// Histogram bucket for a duration: exact below 4 ticks, then four buckets per
+// power of two, so a bucket is never more than 25% wide
+int profileBucket(uint32_t ticks) {
+  if (ticks < 4) return ticks;
+  int octave = 31 - __builtin_clz(ticks);
+  return (octave - 1) * 4 + ((ticks >> (octave - 2)) & 3);
+}
+
+// Smallest duration that falls into a bucket
+uint32_t profileBucketFloor(int bucket) {
+  if (bucket < 4) return bucket;
+  return (uint32_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+#ifdef PROFILE
+uint32_t profileCycles() {
+#if defined(HOST_BUILD)
+  return hostCycleCount();
+#elif defined(ESP32)
+  return ESP.getCycleCount();
+#else
+  return micros();
+#endif
+}
+
+uint32_t profileTicksPerMicro() {
+#if defined(HOST_BUILD)
+  return hostCyclesPerMicro;
+#elif defined(ESP32)
+  return getCpuFrequencyMhz();
+#else
+  return 1;
+#endif
+}
+
+void profileRecord(ProfilePhase phase, uint32_t ticks) {
+  int slot = face.isBlinking && !(faceFlags(face.currentExpression) & FACE_NO_BLINK) ? profileBlinkSlot : face.currentExpression;
+  ProfileHistogram &h = profileHistograms[slot][phase];
+  if (h.count == 0 || ticks < h.minTicks) h.minTicks = ticks;
+  if (ticks > h.maxTicks) h.maxTicks = ticks;
+  h.count++;
+  h.sumTicks += ticks;
+  uint16_t &bucket = h.buckets[profileBucket(ticks)];
+  if (bucket != UINT16_MAX) bucket++;
+}
+
+void profileTick(uint32_t now) {
+  if (now - profileLastReport < profileReportInterval) return;
+  profileLastReport = now;
+  profileDump();
+}
+
+// One dump per report interval:
+//   prof,<sequence>,<ticks per microsecond>
+//   hist,<slot>,<phase>,<count>,<min>,<max>,<sum>[,<bucket>,<samples>]...
+//   end,<sequence>
+// Only non-empty histograms and buckets are sent. Histograms restart after
+// each dump, so the host adds dumps together.
+void profileDump() {
+  Serial.print("prof,");
+  Serial.print((unsigned long)profileSequence);
+  Serial.print(',');
+  Serial.println((unsigned long)profileTicksPerMicro());
+  for (int slot = 0; slot < profileSlots; slot++) {
+    for (int phase = 0; phase < PROFILE_PHASES; phase++) {
+      ProfileHistogram &h = profileHistograms[slot][phase];
+      if (h.count == 0) continue;
+      Serial.print("hist,");
+      Serial.print(slot);
+      Serial.print(',');
+      Serial.print(phase);
+      Serial.print(',');
+      Serial.print((unsigned long)h.count);
+      Serial.print(',');
+      Serial.print((unsigned long)h.minTicks);
+      Serial.print(',');
+      Serial.print((unsigned long)h.maxTicks);
+      Serial.print(',');
+      Serial.print((unsigned long)h.sumTicks);
+      for (int b = 0; b < profileBuckets; b++) {
+        if (h.buckets[b] == 0) continue;
+        Serial.print(',');
+        Serial.print(b);
+        Serial.print(',');
+        Serial.print((unsigned int)h.buckets[b]);
+      }
+      Serial.println();
+    }
+  }
+  Serial.print("end,");
+  Serial.println((unsigned long)profileSequence);
+  profileSequence++;
+  memset(profileHistograms, 0, sizeof(profileHistograms));
+}
+#endif
+
+// 4-bit grayscale path
+// SSD1322-class panels show 16 gray levels, so instead of faking smooth edges
+// with extra 1-bit pixels, shapes are rendered by coverage: each pixel gets the
+// share of its area inside the shape, computed with integer math. The frame is
+// kept in the controller's native layout (two pixels per byte, left pixel in
+// the high nibble) and streamed into display RAM row by row, skipping rows
+// that did not change since the last frame.
+#ifdef DITHER
+const int grayWidth = 128;  // Only the SSD1306's columns
+#else
+const int grayWidth = 256;
+#endif
+const int grayHeight = 64;
+const int grayRowBytes = grayWidth / 2;
+const uint8_t grayColumnStart = 0x1C; // The NHD 256x64 glass starts at RAM column 28
+const uint8_t grayColumnEnd = grayColumnStart + grayWidth / 4 - 1;
+
+// Gray level shapes are drawn at, like U8g2's draw color
+const uint8_t grayLidInk = 3;  // Closed part of a lidded eye
+uint8_t grayInk = 15;
+
+// Only builds that can render gray carry its buffers. Elsewhere grayscale is
+// a constant false, so the calls to the functions below are compiled out.
+#if defined(GRAY4) || defined(DITHER) || defined(HOST_BUILD)
+uint8_t grayBuffer[grayRowBytes * grayHeight];
+uint32_t grayRowHashes[grayHeight]; // Hash of each row as it was last sent
+bool grayRowHashesValid = false;
+
+// Coverage of the row being rasterized, in 1/64ths of a pixel:
+// 4 sub-rows, each covering up to 16 sub-columns
+uint8_t coverageRow[grayWidth];
+int coverageMinX = grayWidth;
+int coverageMaxX = -1;
+
+void grayClearBuffer() {
+  memset(grayBuffer, 0, sizeof(grayBuffer));
+}
+
+// Raise pixel (x, y) to 'level' (0-15); shapes never darken what is below
+void grayBlend(int x, int y, uint8_t level) {
+  if (x < 0 || y < 0 || x >= grayWidth || y >= grayHeight || level == 0) return;
+  uint8_t &pair = grayBuffer[y * grayRowBytes + x / 2];
+  if (x & 1) {
+    if ((pair & 0x0F) < level) pair = (pair & 0xF0) | level;
+  } else {
+    if ((pair >> 4) < level) pair = (pair & 0x0F) | (level << 4);
+  }
+}
+
+// Span at the ink level, already clipped, filling whole bytes where it can
+void graySpan(int x0, int x1, int y) {
+  if (grayInk != 15) {
+    for (int x = x0; x <= x1; x++) {
+      grayBlend(x, y, grayInk);
+    }
+    return;
+  }
+  uint8_t *row = &grayBuffer[y * grayRowBytes];
+  if (x0 & 1) {
+    row[x0 / 2] |= 0x0F;
+    x0++;
+  }
+  if (!(x1 & 1)) {
+    row[x1 / 2] |= 0xF0;
+    x1--;
+  }
+  if (x0 < x1) {
+    memset(&row[x0 / 2], 0xFF, (x1 - x0 + 1) / 2);
+  }
+}
+
+// Column from top to bottom, both in 1/256 pixel; partly covered end pixels
+// get partial intensity
+void grayColumnCoverage(int x, int32_t top, int32_t bottom) {
+  if (bottom <= top) return;
+  for (int y = top >> 8; y <= (bottom - 1) >> 8; y++) {
+    int32_t from = max(top, (int32_t)y * 256);
+    int32_t to = min(bottom, (int32_t)y * 256 + 256);
+    grayBlend(x, y, ((to - from) * grayInk + 128) >> 8);
+  }
+}
+
+// Add the sub-row span [left, right), in 1/16 pixel, to the coverage row
+void addCoverageSpan(int32_t left, int32_t right) {
+  left = max(left, (int32_t)0);
+  right = min(right, (int32_t)grayWidth * 16);
+  if (left >= right) return;
+
+  int xl = left >> 4;
+  int xr = (right - 1) >> 4;
+  if (xl == xr) {
+    coverageRow[xl] += right - left;
+  } else {
+    coverageRow[xl] += 16 - (left & 15);
+    for (int x = xl + 1; x < xr; x++) {
+      coverageRow[x] += 16;
+    }
+    coverageRow[xr] += right - xr * 16;
+  }
+  coverageMinX = min(coverageMinX, xl);
+  coverageMaxX = max(coverageMaxX, xr);
+}
+
+// Turn the accumulated coverage into gray levels on row y and reset it
+void flushCoverageRow(int y) {
+  for (int x = coverageMinX; x <= coverageMaxX; x++) {
+    if (coverageRow[x]) {
+      grayBlend(x, y, (coverageRow[x] * grayInk + 32) >> 6);
+      coverageRow[x] = 0;
+    }
+  }
+  coverageMinX = grayWidth;
+  coverageMaxX = -1;
+}
+
+uint32_t isqrt32(uint32_t value) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value) bit >>= 2;
+  while (bit) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// Anti-aliased filled ellipse. Centre and semi-axes are in 1/16 pixel, with
+// pixel x covering [16x, 16x + 16). Only sub-rows between clipTop and
+// clipBottom are filled, which gives lidded eyes and half-ellipse mouths.
+void grayFillEllipse(int32_t cx, int32_t cy, int32_t a, int32_t b, int32_t clipTop, int32_t clipBottom) {
+  if (a <= 0 || b <= 0) return;
+  int yFirst = max((cy - b) >> 4, (int32_t)0);
+  int yLast = min((cy + b) >> 4, (int32_t)grayHeight - 1);
+  for (int y = yFirst; y <= yLast; y++) {
+    for (int sub = 0; sub < 4; sub++) {
+      int32_t sy = y * 16 + sub * 4 + 2; // Sub-row centre
+      int32_t d = sy - cy;
+      if (sy < clipTop || sy >= clipBottom || d <= -b || d >= b) continue;
+      // Half-width at this sub-row: a * sqrt(1 - d^2/b^2)
+      int32_t root = isqrt32((uint32_t)(b * b - d * d) << 8);
+      int32_t half = root * a / (b * 16);
+      addCoverageSpan(cx - half, cx + half);
+    }
+    flushCoverageRow(y);
+  }
+}
+
+// Wu-style thick line: the stroke's exact edges are tracked in 1/256 pixel
+// along the major axis and the end pixels of each cross-section get partial
+// intensity. Cross-sections line up with drawStrokeLine's 1-bit output.
+void grayStrokeLine(int x0, int y0, int x1, int y1, int width) {
+  bool xMajor = abs(x1 - x0) >= abs(y1 - y0);
+  if (!xMajor) {
+    int t = x0; x0 = y0; y0 = t;
+    t = x1; x1 = y1; y1 = t;
+  }
+  if (x0 > x1) {
+    int t = x0; x0 = x1; x1 = t;
+    t = y0; y0 = y1; y1 = t;
+  }
+
+  int dMajor = x1 - x0;
+  int32_t firstEdge = (int32_t)(y0 - (width - 1) / 2) * 256;
+  for (int step = 0; step <= dMajor; step++) {
+    int32_t top = firstEdge;
+    if (dMajor > 0) {
+      top += (int32_t)(y1 - y0) * 256 * step / dMajor;
+    }
+    int32_t bottom = top + width * 256;
+    for (int minor = top >> 8; minor <= (bottom - 1) >> 8; minor++) {
+      int32_t from = max(top, (int32_t)minor * 256);
+      int32_t to = min(bottom, (int32_t)minor * 256 + 256);
+      uint8_t level = ((to - from) * grayInk + 128) >> 8;
+      if (xMajor) {
+        grayBlend(x0 + step, minor, level);
+      } else {
+        grayBlend(minor, x0 + step, level);
+      }
+    }
+  }
+}
+
+// FNV-1a over one row, to spot rows that did not change
+uint32_t grayRowHash(const uint8_t *row) {
+  uint32_t hash = 2166136261UL;
+  for (int i = 0; i < grayRowBytes; i++) {
+    hash = (hash ^ row[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+// Stream changed rows straight into SSD1322 display RAM. Consecutive changed
+// rows go out as one window and one data transfer, so each run costs a
+// single address setup.
+void graySendBuffer() {
+  const uint8_t columns[] = {0x15, grayColumnStart, grayColumnEnd}; // Column window
+  busWrite(false, columns, 1);
+  busWrite(true, columns + 1, 2);
+
+  int y = 0;
+  while (y < grayHeight) {
+    uint32_t hash = grayRowHash(&grayBuffer[y * grayRowBytes]);
+    if (grayRowHashesValid && hash == grayRowHashes[y]) {
+      y++;
+      continue;
+    }
+
+    // Extend the run over every following changed row
+    int runEnd = y;
+    grayRowHashes[y] = hash;
+    while (runEnd + 1 < grayHeight) {
+      uint32_t next = grayRowHash(&grayBuffer[(runEnd + 1) * grayRowBytes]);
+      if (grayRowHashesValid && next == grayRowHashes[runEnd + 1]) break;
+      grayRowHashes[++runEnd] = next;
+    }
+
+    const uint8_t rows[] = {0x75, (uint8_t)y, (uint8_t)runEnd}; // Row window
+    const uint8_t writeRam = 0x5C;
+    busWrite(false, rows, 1);
+    busWrite(true, rows + 1, 2);
+    busWrite(false, &writeRam, 1);
+    busWrite(true, &grayBuffer[y * grayRowBytes], (runEnd - y + 1) * grayRowBytes);
+    y = runEnd + 1;
+  }
+
+  grayRowHashesValid = true;
+}
+
+float grayLitFraction() {
+  long total = 0;
+  for (unsigned int i = 0; i < sizeof(grayBuffer); i++) {
+    total += (grayBuffer[i] >> 4) + (grayBuffer[i] & 0x0F);
+  }
+  return (float)total / (u8g2.getDisplayWidth() * grayHeight * 15);
+}
+#endif
+
+// Temporal dither
+// The SSD1306 can only switch a pixel on or off, but a pixel lit in one or
+// two of every three refreshes reads as a dimmer shade. With DITHER, frames
+// are rendered by the 4-bit path above into the left 128 columns of
+// grayBuffer and quantized to four levels, kept as two bit planes in the
+// panel's page layout. The dither task then shows one 1-bit subframe every
+// ditherSubframeInterval, each byte of it a single bitwise op on the planes.
+// Columns are offset in phase so neighbouring pixels of a shade take turns,
+// which flickers less than a whole area blinking together. Only the columns
+// that differ from what the panel shows are sent, in a window per run, so a
+// subframe costs the soft edges and not the whole screen; faces without any
+// shades send one subframe and stop.
+#if defined(DITHER) || defined(HOST_BUILD)
+const int ditherColumns = 128;
+const int ditherPages = 8;
+const int ditherBytes = ditherColumns * ditherPages;
+const uint32_t ditherSubframeInterval = 6000;  // us; a full cycle of three runs at 55 Hz
+const int ditherRunGap = 12;  // Unchanged columns worth sending to save a new window
+
+// 4-bit gray to dither level (0-3)
+const uint8_t ditherLevels[16] = {0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3};
+
+uint8_t ditherHigh[ditherBytes];   // Bit 1 of each pixel's level
+uint8_t ditherLow[ditherBytes];    // Bit 0
+uint8_t ditherShown[ditherBytes];  // What the panel shows now
+bool ditherShownValid = false;
+bool ditherMixed = false;    // Some pixels are neither off nor full
+bool ditherPending = false;  // New planes have not been shown yet
+uint8_t ditherPhase = 0;
+uint8_t ditherPage = 0;
+uint32_t ditherSubframeDue = 0;
+unsigned long subframesSent = 0;
+
+// Turn the rendered 4-bit frame into the two level planes
+void ditherQuantize() {
+  ditherMixed = false;
+  for (int page = 0; page < ditherPages; page++) {
+    for (int x = 0; x < ditherColumns; x++) {
+      uint8_t high = 0, low = 0;
+      for (int bit = 0; bit < 8; bit++) {
+        uint8_t pair = grayBuffer[(page * 8 + bit) * grayRowBytes + x / 2];
+        uint8_t level = ditherLevels[x & 1 ? pair & 0x0F : pair >> 4];
+        high |= (level >> 1) << bit;
+        low |= (level & 1) << bit;
+      }
+      ditherHigh[page * ditherColumns + x] = high;
+      ditherLow[page * ditherColumns + x] = low;
+      ditherMixed = ditherMixed || (high ^ low);
+    }
+  }
+  ditherPending = true;
+  if (ditherTask) taskWake(*ditherTask);
+}
+
+// Subframe 'phase' (0-2) into 'out'. Phase 0 lights every level from 1 up,
+// phase 1 levels 2 and 3, phase 2 only level 3.
+void ditherSubframe(uint8_t phase, uint8_t *out) {
+  for (int page = 0; page < ditherPages; page++) {
+    int p = (phase + page) % 3;
+    for (int i = page * ditherColumns; i < (page + 1) * ditherColumns; i++) {
+      if (p == 0) {
+        out[i] = ditherHigh[i] | ditherLow[i];
+      } else if (p == 1) {
+        out[i] = ditherHigh[i];
+      } else {
+        out[i] = ditherHigh[i] & ditherLow[i];
+      }
+      if (++p == 3) p = 0;
+    }
+  }
+}
+
+// Send the columns of one page of 'next' that the panel does not show yet.
+// Returns true if anything went out.
+bool ditherSendPage(const uint8_t *next, int page) {
+  const uint8_t *row = next + page * ditherColumns;
+  uint8_t *shown = ditherShown + page * ditherColumns;
+  bool sent = false;
+  int x = 0;
+  while (x < ditherColumns) {
+    if (ditherShownValid && row[x] == shown[x]) {
+      x++;
+      continue;
+    }
+    // Extend the run until a long enough stretch of unchanged columns
+    int first = x, last = x;
+    for (x++; x < ditherColumns && x - last <= ditherRunGap; x++) {
+      if (!ditherShownValid || row[x] != shown[x]) last = x;
+    }
+    const uint8_t window[] = {0x21, (uint8_t)first, (uint8_t)last, 0x22, (uint8_t)page, (uint8_t)page};
+    busWrite(false, window, sizeof(window));
+    busWrite(true, row + first, last - first + 1);
+    memcpy(shown + first, row + first, last - first + 1);
+    sent = true;
+    x = last + 1;
+  }
+  return sent;
+}
+
+bool ditherActive() {
+  return grayscale && panelController == CONTROLLER_SSD1306 && !panelPowerSave &&
+         (ditherMixed || ditherPending);
+}
+
+// Show the next subframe, a page at a time, then wait for the one after. The
+// subframe is built in U8g2's buffer, which the gray path leaves unused.
+void runDitherTask(Task &task) {
+  TASK_BEGIN(task);
+  while (true) {
+    TASK_WAIT_UNTIL(task, ditherActive());
+    ditherSubframeDue = task.due;
+    if (!ditherShownValid) {
+      const uint8_t horizontal[] = {0x20, 0x00};
+      busWrite(false, horizontal, sizeof(horizontal));
+    }
+    ditherPending = false;
+    ditherSubframe(ditherPhase, u8g2.getBufferPtr());
+    ditherPhase = ditherPhase == 2 ? 0 : ditherPhase + 1;
+    for (ditherPage = 0; ditherPage < ditherPages; ditherPage++) {
+      if (ditherSendPage(u8g2.getBufferPtr(), ditherPage)) {
+        TASK_YIELD(task);
+      }
+    }
+    ditherShownValid = true;
+    subframesSent++;
+    TASK_SLEEP_UNTIL(task, ditherSubframeDue + ditherSubframeInterval);
+  }
+  TASK_END(task);
+}
+#endif
+
+// Stroke engine
+// Thick lines and quadratic curves are walked with integer steps and emitted
+// as horizontal or vertical spans, so strokes have no gaps on steep sections
+// and each run of pixels costs a single u8g2 call.
+
+// Plot a single pixel on whichever frame buffer is active
+void plotPixel(int x, int y) {
+  if (grayscale) {
+    grayBlend(x, y, grayInk);
+  } else {
+    u8g2.drawPixel(x, y);
+  }
+}
+
+// Fill a horizontal span from x0 to x1 (inclusive), clipped to the panel
+void fillSpan(int x0, int x1, int y) {
+  if (x0 > x1) {
+    int t = x0; x0 = x1; x1 = t;
+  }
+  if (y < 0 || y >= u8g2.getDisplayHeight()) return;
+  if (x0 < 0) x0 = 0;
+  if (x1 >= u8g2.getDisplayWidth()) x1 = u8g2.getDisplayWidth() - 1;
+  if (x0 > x1) return;
+  if (grayscale) {
+    graySpan(x0, x1, y);
+  } else {
+    u8g2.drawHLine(x0, y, x1 - x0 + 1);
+  }
+}
+
+// Fill a vertical span from y0 to y1 (inclusive), clipped to the panel
+void fillColumn(int x, int y0, int y1) {
+  if (y0 > y1) {
+    int t = y0; y0 = y1; y1 = t;
+  }
+  if (x < 0 || x >= u8g2.getDisplayWidth()) return;
+  if (y0 < 0) y0 = 0;
+  if (y1 >= u8g2.getDisplayHeight()) y1 = u8g2.getDisplayHeight() - 1;
+  if (y0 > y1) return;
+  if (grayscale) {
+    grayColumnCoverage(x, (int32_t)y0 * 256, (int32_t)(y1 + 1) * 256);
+  } else {
+    u8g2.drawVLine(x, y0, y1 - y0 + 1);
+  }
+}
+
+// Emit one run of a stroke: 'width' parallel spans across the minor axis
+void strokeRun(bool xMajor, int from, int to, int minor, int width) {
+  int first = minor - (width - 1) / 2;
+  for (int o = first; o < first + width; o++) {
+    if (xMajor) {
+      fillSpan(from, to, o);
+    } else {
+      fillColumn(o, from, to);
+    }
+  }
+}
+
+// Add a run to 'run', emitting the pending one first unless the two join up
+void queueRun(PendingRun &run, bool xMajor, int from, int to, int minor, int width) {
+  if (from > to) {
+    int t = from; from = to; to = t;
+  }
+  if (run.active && run.xMajor == xMajor && run.minor == minor &&
+      from <= run.to + 1 && to >= run.from - 1) {
+    run.from = min(run.from, from);
+    run.to = max(run.to, to);
+    return;
+  }
+  if (run.active) {
+    strokeRun(run.xMajor, run.from, run.to, run.minor, width);
+  }
+  run = {true, xMajor, from, to, minor};
+}
+
+void flushRun(PendingRun &run, int width) {
+  if (run.active) {
+    strokeRun(run.xMajor, run.from, run.to, run.minor, width);
+    run.active = false;
+  }
+}
+
+// Bresenham walk along the major axis, collecting runs of pixels that share a
+// minor coordinate
+void walkStrokeLine(PendingRun &run, int x0, int y0, int x1, int y1, int width) {
+  bool xMajor = abs(x1 - x0) >= abs(y1 - y0);
+  if (!xMajor) {
+    // Walk along y by swapping the axes
+    int t = x0; x0 = y0; y0 = t;
+    t = x1; x1 = y1; y1 = t;
+  }
+
+  int dMajor = abs(x1 - x0);
+  int dMinor = abs(y1 - y0);
+  int sMajor = (x0 < x1) ? 1 : -1;
+  int sMinor = (y0 < y1) ? 1 : -1;
+  int err = dMajor / 2;
+  int runStart = x0;
+  int minor = y0;
+
+  for (int major = x0; major != x1; major += sMajor) {
+    err -= dMinor;
+    if (err < 0) {
+      queueRun(run, xMajor, runStart, major, minor, width);
+      minor += sMinor;
+      err += dMajor;
+      runStart = major + sMajor;
+    }
+  }
+  queueRun(run, xMajor, runStart, x1, minor, width);
+}
+
+// Thick line: every run of the walk becomes 'width' spans
+void drawStrokeLine(int x0, int y0, int x1, int y1, int width) {
+  if (grayscale) {
+    grayStrokeLine(x0, y0, x1, y1, width);
+    return;
+  }
 
-void setup() {
-  u8g2.begin();
-  u8g2.setDrawColor(1); // White
-  u8g2.setFont(u8g2_font_helvB12_tr);
-  
-  // Initialize random seed
-  randomSeed(analogRead(0));
+  PendingRun run = {};
+  walkStrokeLine(run, x0, y0, x1, y1, width);
+  flushRun(run, width);
 }
 
-void loop() {
-  unsigned long currentMillis = millis();
-
-  // Check if it's time to blink
-  if (!isBlinking && currentMillis - lastBlinkTime >= blinkInterval) {
-    isBlinking = true;
-    lastBlinkTime = currentMillis;
-  } 
-  else if (isBlinking && currentMillis - lastBlinkTime >= blinkDuration) {
-    isBlinking = false;
-    lastBlinkTime = currentMillis;
-    // Randomize next blink interval slightly (3-5 seconds)
-    blinkInterval = random(3000, 5000);
+// Quadratic Bezier from (x0,y0) to (x2,y2) with control point (x1,y1).
+// Points come from integer forward differencing in 16.16 fixed point over a
+// power-of-two number of steps (so the last point lands exactly on the end)
+// and are joined with stroke lines. In 1-bit the chords share one pending run,
+// so a chord that carries on along the same row costs nothing extra.
+void drawStrokeQuad(int x0, int y0, int x1, int y1, int x2, int y2, int width) {
+  // Aim for chords of about two pixels
+  int length = max(abs(x1 - x0), abs(y1 - y0)) + max(abs(x2 - x1), abs(y2 - y1));
+  int shift = 1;
+  while ((1 << shift) < length / 2 && shift < 6) {
+    shift++;
   }
 
-  // Update tear animation
-  if (currentExpression == CRYING && currentMillis - lastTearUpdateTime >= tearUpdateInterval) {
-    tearFrame = !tearFrame;  // Toggle between 0 and 1
-    lastTearUpdateTime = currentMillis;
-    tearCount++;
-    
-    // After 20 tear frames (about 3 seconds), reset tears position
-    if (tearCount >= 20) {
-      tearCount = 0;
+  // B(t) = P0 + b*t + a*t^2 with a = P0 - 2*P1 + P2, b = 2*(P1 - P0)
+  int32_t ax = x0 - 2 * x1 + x2;
+  int32_t ay = y0 - 2 * y1 + y2;
+  int32_t bx = 2 * (x1 - x0);
+  int32_t by = 2 * (y1 - y0);
+  int32_t px = (int32_t)x0 * 65536;
+  int32_t py = (int32_t)y0 * 65536;
+  int32_t dx = bx * (1L << (16 - shift)) + ax * (1L << (16 - 2 * shift));
+  int32_t dy = by * (1L << (16 - shift)) + ay * (1L << (16 - 2 * shift));
+  int32_t ddx = ax * (1L << (17 - 2 * shift));
+  int32_t ddy = ay * (1L << (17 - 2 * shift));
+
+  PendingRun run = {};
+  int lastX = x0;
+  int lastY = y0;
+  for (int i = 0; i < (1 << shift); i++) {
+    px += dx;
+    py += dy;
+    dx += ddx;
+    dy += ddy;
+    int x = (px + 32768) >> 16;
+    int y = (py + 32768) >> 16;
+    if (grayscale) {
+      drawStrokeLine(lastX, lastY, x, y, width);
+    } else {
+      walkStrokeLine(run, lastX, lastY, x, y, width);
     }
+    lastX = x;
+    lastY = y;
   }
+  flushRun(run, width);
+}
 
-  // Update random eye movements when idle
-  if (currentMillis - lastEyeMoveTime >= eyeMoveInterval) {
-    // Make eyes look in a wilder random direction
-    eyeOffsetX = random(-8, 9);  // -8 to +8 pixels
-    eyeOffsetY = random(-5, 6);  // -5 to +5 pixels
+// Helper function for smooth line drawing
+void drawSmoothLine(int x0, int y0, int x1, int y1, float thickness) {
+  drawStrokeLine(x0, y0, x1, y1, thickness > 1.0 ? 3 : 1);
+}
 
-    // Move mouth exactly the same as eyes
-    mouthOffsetX = eyeOffsetX;
-    mouthOffsetY = eyeOffsetY;
+// Face program interpreter
+
+uint16_t faceWord(const uint8_t *p) {
+  return pgm_read_byte(p) | (uint16_t)pgm_read_byte(p + 1) << 8;
+}
 
-    lastEyeMoveTime = currentMillis;
-    lastMouthMoveTime = currentMillis;
+// Check a program before it is trusted: header, opcodes, operand terms and
+// slot/variable indices, all within 'size' bytes
+bool faceProgramValid(const uint8_t *program, size_t size) {
+  if (size < faceHeaderSize + 1) return false;
+  if (pgm_read_byte(program) != 'F' || pgm_read_byte(program + 1) != 'X') return false;
+  if (pgm_read_byte(program + 2) != faceVersion) return false;
+  if (pgm_read_byte(program + 3) >= expressionCount) return false;
+  if (faceWord(program + 5) > faceWord(program + 7)) return false;
+  if (faceWord(program + 7) > maxExpressionDwell) return false;
+  if (faceWord(program + 9) != size) return false;
 
-    // Randomize next movement interval (same for both)
-    eyeMoveInterval = random(500, 2500);
-    mouthMoveInterval = eyeMoveInterval; // Sync intervals exactly
+  const uint8_t *pc = program + faceHeaderSize;
+  const uint8_t *end = program + size;
+  while (pc < end) {
+    uint8_t op = pgm_read_byte(pc++);
+    if (op == OP_END) return pc == end;
+    if (op >= FACE_OPS) return false;
+    for (int i = 0; i < faceOperandCounts[op]; i++) {
+      if (pc >= end) return false;
+      int terms = pgm_read_byte(pc++);
+      int vars = 0;
+      for (int t = 0; t < terms; t++) {
+        if (end - pc < 2) return false;
+        uint8_t kind = pgm_read_byte(pc);
+        uint8_t arg = pgm_read_byte(pc + 1);
+        switch (kind) {
+          case TERM_CONST:
+            break;
+          case TERM_SLOT:
+          case TERM_SLOT_NEG:
+            if (arg >= LAYOUT_SLOTS) return false;
+            break;
+          case TERM_VAR:
+          case TERM_VAR_NEG:
+            if (arg >= FACE_VARS || ++vars > 2) return false;
+            break;
+          case TERM_SLOT_SCALED:
+            if (arg >= LAYOUT_SLOTS || end - pc < 4 || pgm_read_byte(pc + 3) == 0) return false;
+            pc += 2;
+            break;
+          default:
+            return false;
+        }
+        pc += 2;
+      }
+    }
   }
-  
-  // Change expression periodically
-  if (currentMillis - lastExpressionChange >= expressionDuration) {
-    // Cycle through expressions including CRYING
-    switch (currentExpression) {
-      case HAPPY:
-        currentExpression = SAD;
-        break;
-      case SAD:
-        currentExpression = NEUTRAL;
-        break;
-      case NEUTRAL:
-        currentExpression = ANGRY;
-        break;
-      case ANGRY:
-        currentExpression = SURPRISED;
-        break;
-      case SURPRISED:
-        currentExpression = SLEEPY;  // Added CRYING to cycle
-        break;
-      case SLEEPY: 
-        currentExpression = SLEEPING; 
-        break;
-      case SLEEPING: 
-        currentExpression = CRYING; 
-        break;
-      case CRYING:
-        currentExpression = HAPPY;
-        break;
+  return false;  // No OP_END
+}
+
+// Use a program for the expression named in its header
+bool installFaceProgram(const uint8_t *program, size_t size) {
+  if (!faceProgramValid(program, size)) return false;
+  uint8_t expression = pgm_read_byte(program + 3);
+#if defined(FACE_FILES)
+  if (facePrograms[expression] != program) releaseFaceProgram(facePrograms[expression]);
+#endif
+  facePrograms[expression] = program;
+  bindFacePrograms();
+  return true;
+}
+
+#if defined(FACE_FILES)
+// Free a program read from LittleFS once nothing uses it; the faces.h
+// programs live in flash
+void releaseFaceProgram(const uint8_t *program) {
+  if (!program) return;
+  for (const uint8_t *const *builtin = builtinFaces; *builtin; builtin++) {
+    if (program == *builtin) return;
+  }
+  free((void *)program);
+}
+#endif
+
+// Built-in programs from faces.h, then any replacements from LittleFS
+void loadFacePrograms() {
+  for (const uint8_t *const *builtin = builtinFaces; *builtin; builtin++) {
+    installFaceProgram(*builtin, faceWord(*builtin + 9));
+  }
+#if defined(FACE_FILES)
+  if (!LittleFS.begin()) return;
+  File dir = LittleFS.open("/faces");
+  for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    size_t size = file.size();
+    uint8_t *program = (uint8_t *)malloc(size);
+    if (program && file.read(program, size) == size && installFaceProgram(program, size)) continue;
+    free(program);  // Bad files are skipped; the built-in face stays
+  }
+#endif
+}
+
+// Draw a shape with every variable at zero and read it back from the 1-bit
+// buffer as spans. Returns the number of spans, or 0 if the shape moves in a
+// way spans cannot follow, touches the panel edge (and so may be clipped) or
+// needs more than 'capacity' of them.
+int captureFaceSpans(uint8_t op, const FaceValue *operands, FaceValue *spans, int capacity) {
+  if (grayscale || !faceXOperands[op]) return 0;
+  const FaceValue *x = nullptr;
+  const FaceValue *y = nullptr;
+  int v[7];
+  for (int i = 0; i < faceOperandCounts[op]; i++) {
+    const FaceValue &value = operands[i];
+    const FaceValue *&axis = faceXOperands[op] & (1 << i) ? x : y;
+    if (faceXOperands[op] & (1 << i) || faceYOperands[op] & (1 << i)) {
+      if (axis && (axis->varA != value.varA || axis->varB != value.varB)) return 0;
+      axis = &value;
+    } else if (value.varA) {
+      return 0;
     }
-    lastExpressionChange = currentMillis;
-    // Randomize next expression duration (4-7 seconds)
-    expressionDuration = random(4000, 7000);
+    v[i] = value.base;
   }
 
   u8g2.clearBuffer();
-  
-  if (isBlinking && currentExpression != SLEEPING) {
-    drawBlinkingEyes();
-  } else {
-    // Draw the current expression
-    switch (currentExpression) {
-      case HAPPY:
-        drawHappyEyes();
-        break;
-      case SAD:
-        drawSadEyes();
-        break;
-      case NEUTRAL:
-        drawNeutralEyes();
-        break;
-      case ANGRY:
-        drawAngryEyes();
-        break;
-      case SURPRISED:
-        drawSurprisedEyes();
-        break;
-      case CRYING:
-        drawCryingEyes(tearFrame);
-        break;
-      case SLEEPY: 
-        drawSleepyEyes();
-        break;
-      case SLEEPING:
-        updateSleepBubblePhase();  
-        drawSleepingEyes();
-        break;
+  drawFaceOp(op, v);
+  const uint8_t *buffer = u8g2.getBufferPtr();
+  const int width = u8g2.getBufferTileWidth() * 8;
+  const int height = u8g2.getBufferTileHeight() * 8;
+  int count = 0;
+  bool edge = false;
+  for (int row = 0; row < height && !edge; row++) {
+    const uint8_t *page = buffer + (row >> 3) * width;
+    uint8_t bit = 1 << (row & 7);
+    for (int col = 0; col < width; col++) {
+      if (!(page[col] & bit)) continue;
+      int start = col;
+      while (col + 1 < width && (page[col + 1] & bit)) col++;
+      edge = edge || row == 0 || row == height - 1 || start == 0 || col == width - 1 || col - start > 255;
+      if (count == capacity) edge = true;
+      if (edge) break;
+      spans[count++] = {(int16_t)start, (uint8_t)row, (uint8_t)(col - start)};
+    }
+  }
+  u8g2.clearBuffer();
+  return edge ? 0 : count;
+}
+
+// Fold the layout into a validated program, turning shapes into spans while
+// 'spanCapacity' allows. Returns the number of FaceValues written, or 0 if
+// 'capacity' is too small.
+int bindFaceProgram(const uint8_t *program, FaceValue *code, int capacity, int spanCapacity) {
+  const uint8_t *pc = program + faceHeaderSize;
+  int used = 0;
+  for (;;) {
+    uint8_t op = pgm_read_byte(pc++);
+    if (used + 1 + faceOperandCounts[op] > capacity) return 0;
+    FaceValue &opcode = code[used++];
+    opcode = {op, 0, 0};
+    if (op == OP_END) return used;
+    const int operandsAt = used;
+    for (int i = 0; i < faceOperandCounts[op]; i++) {
+      FaceValue &value = code[used++];
+      value = {0, 0, 0};
+      int terms = pgm_read_byte(pc++);
+      while (terms--) {
+        uint8_t kind = pgm_read_byte(pc);
+        uint8_t arg = pgm_read_byte(pc + 1);
+        pc += 2;
+        switch (kind) {
+          case TERM_CONST: value.base += (int8_t)arg; break;
+          case TERM_SLOT: value.base += layout[arg]; break;
+          case TERM_SLOT_NEG: value.base -= layout[arg]; break;
+          case TERM_VAR:
+          case TERM_VAR_NEG: {
+            uint8_t entry = 1 + 2 * arg + (kind == TERM_VAR_NEG);
+            if (arg == VAR_BREATH) opcode.varA = 1;
+            if (value.varA == 0) {
+              value.varA = entry;
+            } else {
+              value.varB = entry;
+            }
+            break;
+          }
+          case TERM_SLOT_SCALED:
+            value.base += layout[arg] * (int8_t)pgm_read_byte(pc) / pgm_read_byte(pc + 1);
+            pc += 2;
+            break;
+        }
+      }
+    }
+    int room = min(capacity - used, spanCapacity) - 1;
+    int spans = room > 0 ? captureFaceSpans(op, &code[operandsAt], &code[used + 1], room) : 0;
+    if (spans) {
+      code[operandsAt - 1].varB = 1;
+      code[used] = {(int16_t)spans, 0, 0};
+      used += 1 + spans;
+      spanCapacity -= 1 + spans;
     }
   }
+}
 
+// Rebind every installed program; called whenever the layout or a program
+// changes. Spans only get the room the plain programs leave, so they never
+// crowd a program out.
+void bindFacePrograms() {
+  int plainSize[expressionCount];
+  int plain = 0;
+  for (int e = 0; e < expressionCount; e++) {
+    plainSize[e] = facePrograms[e] ? bindFaceProgram(facePrograms[e], faceCode, faceCodeCapacity, 0) : 0;
+    plain += plainSize[e];
+  }
+  int spanRoom = faceCodeCapacity - plain;
+  int used = 0;
+  for (int e = 0; e < expressionCount; e++) {
+    faceCodeStart[e] = -1;
+    if (!facePrograms[e]) continue;
+    int size = bindFaceProgram(facePrograms[e], &faceCode[used], faceCodeCapacity - used, spanRoom);
+    if (size == 0) {
+#if defined(FACE_FILES)
+      releaseFaceProgram(facePrograms[e]);
+#endif
+      facePrograms[e] = nullptr;  // Out of room; the built-in face stays
+      continue;
+    }
+    faceCodeStart[e] = used;
+    used += size;
+    spanRoom -= size - plainSize[e];
+  }
+}
 
-  u8g2.sendBuffer();
+uint8_t faceFlags(EyeExpression expression) {
+  if (facePrograms[expression]) return pgm_read_byte(facePrograms[expression] + 4);
+  return expression == SLEEPING ? FACE_ANIMATES | FACE_NO_BLINK : 0;
+}
 
-  delay(30); // small delay to smooth out updates
+// How long to hold an expression once it is entered
+int faceDwell(EyeExpression expression) {
+  const uint8_t *program = facePrograms[expression];
+  if (!program) return faceRandom(4000, 7000);
+  return faceRandom(faceWord(program + 5), faceWord(program + 7) + 1);
 }
 
-// Helper function for anti-aliased line drawing
-void drawSmoothLine(int x0, int y0, int x1, int y1, float thickness = 1.0) {
-  // Bresenham's algorithm with anti-aliasing
-  int dx = abs(x1 - x0);
-  int dy = abs(y1 - y0);
-  int sx = (x0 < x1) ? 1 : -1;
-  int sy = (y0 < y1) ? 1 : -1;
-  int err = dx - dy;
-  
-  float intensity;
-  int e2;
-  
-  while (true) {
-    // Draw main pixel at full intensity
-    u8g2.drawPixel(x0, y0);
-    
-    // Draw surrounding pixels with varying intensity for anti-aliasing
-    if (thickness > 1.0) {
-      // Vertical thickness
-      if (dx > dy) {
-        u8g2.drawPixel(x0, y0 + 1);
-        u8g2.drawPixel(x0, y0 - 1);
-      } 
-      // Horizontal thickness
-      else {
-        u8g2.drawPixel(x0 + 1, y0);
-        u8g2.drawPixel(x0 - 1, y0);
-      }
+// Draw one frame of a bound face program
+void runFaceProgram(const FaceValue *code) {
+  int vars[faceVarTableSize] = {
+    0,
+    face.eyeOffsetX, -face.eyeOffsetX, face.eyeOffsetY, -face.eyeOffsetY,
+    face.mouthOffsetX, -face.mouthOffsetX, face.mouthOffsetY, -face.mouthOffsetY,
+    0, 0,  // Breathing, filled in by the ops that use it
+    face.tearFrame, -face.tearFrame, !face.tearFrame, -!face.tearFrame,
+  };
+
+  int v[7];
+  for (;;) {
+    uint8_t op = code->base;
+    if (op == OP_END) return;
+    if (code->varA) {
+      int breath = sleepBreath();
+      vars[1 + 2 * VAR_BREATH] = breath;
+      vars[2 + 2 * VAR_BREATH] = -breath;
     }
-    
-    if (x0 == x1 && y0 == y1) break;
-    e2 = 2 * err;
-    if (e2 > -dy) {
-      err -= dy;
-      x0 += sx;
+    bool spans = code->varB;
+    const FaceValue *operands = code + 1;
+    int count = faceOperandCounts[op];
+    for (int i = 0; i < count; i++) {
+      const FaceValue &value = operands[i];
+      v[i] = value.base + vars[value.varA] + vars[value.varB];
     }
-    if (e2 < dx) {
-      err += dx;
-      y0 += sy;
+    code = operands + count;
+    if (spans) {
+      const FaceValue *span = code + 1;
+      code = span + code->base;
+      if (!grayscale) {
+        // The shape as captured, moved by the live variables
+        int dx = v[0] - operands[0].base;
+        int dy = v[1] - operands[1].base;
+        for (; span < code; span++) {
+          fillSpan(span->base + dx, span->base + span->varB + dx, span->varA + dy);
+        }
+        continue;
+      }
     }
+    drawFaceOp(op, v);
+  }
+}
+
+// One op of a face program with its operands worked out
+void drawFaceOp(uint8_t op, const int *v) {
+  switch (op) {
+    case OP_OVAL:
+      drawSmoothOval(v[0], v[1], v[2], v[3]);
+      break;
+    case OP_LIDDED:
+      drawLiddedEye(v[0], v[1], v[2], v[3], v[4], v[5]);
+      break;
+    case OP_LINE:
+      drawStrokeLine(v[0], v[1], v[2], v[3], v[4]);
+      break;
+    case OP_QUAD:
+      drawStrokeQuad(v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+      break;
+    case OP_ADVANCE:
+      updateSleepBubblePhase();
+      break;
+    case OP_BUBBLES:
+      drawSleepBubble(v[0], v[1]);
+      break;
+    case OP_TEARS:
+      drawTear(v[0], v[1], v[2], v[3]);
+      break;
   }
 }
 
@@ -226,7 +2161,7 @@ void drawSmoothFilledCircle(int x0, int y0, int radius) {
   for (int y = -radius; y <= radius; y++) {
     for (int x = -radius; x <= radius; x++) {
       if (x*x + y*y <= radius*radius) {
-        u8g2.drawPixel(x0 + x, y0 + y);
+        plotPixel(x0 + x, y0 + y);
       } 
       // Anti-aliasing for edge pixels
       else if (x*x + y*y <= (radius+1)*(radius+1)) {
@@ -234,7 +2169,7 @@ void drawSmoothFilledCircle(int x0, int y0, int radius) {
         float distance = sqrtf(x*x + y*y);
         if (distance < radius + 1.0f && distance > radius - 0.5f) {
           // Only fill edge pixels that would smooth curve
-          u8g2.drawPixel(x0 + x, y0 + y);
+          plotPixel(x0 + x, y0 + y);
         }
       }
     }
@@ -243,6 +2178,12 @@ void drawSmoothFilledCircle(int x0, int y0, int radius) {
 
 // Draw smooth oval with anti-aliasing
 void drawSmoothOval(int centerX, int centerY, int width, int height) {
+  if (grayscale) {
+    // Real coverage; the half pixel stands in for the 1-bit fringe
+    grayFillEllipse(centerX * 16 + 8, centerY * 16 + 8, width * 8 + 8, height * 8 + 8, 0, grayHeight * 16);
+    return;
+  }
+
   for (int y = -height/2 - 1; y <= height/2 + 1; y++) {
     for (int x = -width/2 - 1; x <= width/2 + 1; x++) {
       float normalizedX = (float)x / (width/2.0f);
@@ -251,71 +2192,72 @@ void drawSmoothOval(int centerX, int centerY, int width, int height) {
       
       if (distance <= 1.0f) {
         // Inside the oval - full intensity pixel
-        u8g2.drawPixel(centerX + x, centerY + y);
+        plotPixel(centerX + x, centerY + y);
       }
       // Edge pixel - anti-aliasing (slightly outside boundary)
       else if (distance < 1.15f) {
         // Draw edge pixels to smooth the curve
-        u8g2.drawPixel(centerX + x, centerY + y);
+        plotPixel(centerX + x, centerY + y);
       }
     }
   }
 }
 
 void drawHappyEyes() {
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 24 + eyeOffsetY;
-  const int eyeWidth = 14;
-  const int eyeHeight = 20;
-  const int mouthY = 52 + mouthOffsetY;
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_Y] + face.eyeOffsetY;
+  const int eyeWidth = layout[EYE_WIDTH];
+  const int eyeHeight = layout[EYE_HEIGHT];
+  const int mouthY = layout[MOUTH_Y] + face.mouthOffsetY;
 
   // Draw smooth ovals for eyes
   drawSmoothOval(leftEyeX, eyeY, eyeWidth, eyeHeight);
   drawSmoothOval(rightEyeX, eyeY, eyeWidth, eyeHeight);
   
-  // Draw smile with subtle movement and smoothing
-  for (int x = -10; x <= 10; x++) { 
-    float xf = (float)x / 10.0f;  // Normalize x
-    float y = -(xf * xf) * 6.0f;  // Smoother parabola
-    
-    // Main curve with anti-aliasing
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y);
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y + 1); // Thicker line
-    
-    // Anti-aliasing for smoother edges at the ends
-    if (abs(x) >= 8) {
-      u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y - 1);
-    }
-  }
+  // Draw smile: parabola through the corners (±half, -depth) and the bottom at (0, 0)
+  const int mouthX = layout[FACE_CENTER_X] + face.mouthOffsetX;
+  const int half = layout[MOUTH_HALF];
+  const int depth = layout[SMILE_DEPTH];
+  drawStrokeQuad(mouthX - half, mouthY - depth, mouthX, mouthY + depth, mouthX + half, mouthY - depth,
+                 layout[STROKE_BOLD]);
 }
 
 void drawSadEyes() {
   // Eye parameters
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeCenterY = 28 + eyeOffsetY; // Move a bit down for better proportions
-  const int eyeWidth = 16;
-  const int eyeHeight = 16;
-  const int mouthY = 54 + mouthOffsetY;
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeCenterY = layout[EYE_LOW_Y] + face.eyeOffsetY; // Move a bit down for better proportions
+  const int mouthY = layout[MOUTH_LOW_Y] + face.mouthOffsetY;
 
   // Helper lambda to draw smooth sad eyes
   auto drawSmoothSadEye = [](int centerX, int centerY, bool slantLeft) {
-    for (int x = -8; x <= 8; x++) {
-      float xf = (float)x / 8.0f; // normalize x from -1 to 1
-      float curve = (1.0f - xf * xf) * 6.0f; // eye shape curve
-      int slant = (int)(xf * 4.0f); // slant: stronger, proportional to x
+    const int half = layout[SAD_EYE_HALF];
+    for (int x = -half; x <= half; x++) {
+      if (grayscale) {
+        // Exact slant and curve in 8.8 fixed point; the bottom pixel is shaded by coverage
+        int32_t exactSlant = (int32_t)x * layout[EYE_SLANT] * 256 / half;
+        if (slantLeft) exactSlant = -exactSlant;
+        int32_t top = (int32_t)centerY * 256 + exactSlant;
+        int32_t depth = (int32_t)(half * half - x * x) * layout[SAD_EYE_DEPTH] * 256 / (half * half);
+        grayColumnCoverage(centerX + x, top, top + depth);
+        continue;
+      }
+
+      float xf = (float)x / half; // normalize x from -1 to 1
+      float curve = (1.0f - xf * xf) * layout[SAD_EYE_DEPTH]; // eye shape curve
+      int slant = (int)(xf * layout[EYE_SLANT]); // slant: stronger, proportional to x
       if (slantLeft) slant = -slant;
       int yBase = centerY + slant;
-      
-      // Draw main curve with anti-aliasing
-      for (int y = 0; y < (int)curve; y++) {
-        u8g2.drawPixel(centerX + x, yBase + y);
+
+      // Draw main curve as one column
+      if ((int)curve > 0) {
+        fillColumn(centerX + x, yBase, yBase + (int)curve - 1);
       }
       
       // Anti-aliasing for edges
-      if (abs(x) >= 6) {
-        u8g2.drawPixel(centerX + x, yBase + (int)curve);
+      if (abs(x) >= half - half / 4) {
+        plotPixel(centerX + x, yBase + (int)curve);
       }
     }
   };
@@ -324,171 +2266,122 @@ void drawSadEyes() {
   drawSmoothSadEye(leftEyeX, eyeCenterY, true);  // Left eye slants downward
   drawSmoothSadEye(rightEyeX, eyeCenterY, false); // Right eye slants upward
 
-  // Draw sad mouth - soft arc with anti-aliasing
-  for (int x = -12; x <= 12; x++) { 
-    float xf = (float)x / 12.0f; // normalize
-    float y = 4.0f * (xf*xf); // upward curve (sad mouth)
-    
-    // Draw main curve with anti-aliasing
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y);
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y + 1); // slight thickness
-    
-    // Add anti-aliasing at the ends
-    if (abs(x) >= 10) {
-      u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y - 1);
-    }
-  }
+  // Draw sad mouth - soft arc
+  drawSadMouth(layout[FACE_CENTER_X] + face.mouthOffsetX, mouthY);
 }
 
-void drawNeutralEyes() {
-  // Improved eye parameters with more spacing
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 24 + eyeOffsetY;
-  const int eyeWidth = 14;
-  const int eyeHeight = 20;
-  const int mouthY = 52 + mouthOffsetY;
-
-  // Draw left eye (1/4th closed) with smoother edges
-  for (int x = leftEyeX - eyeWidth/2 - 1; x <= leftEyeX + eyeWidth/2 + 1; x++) {
-    for (int y = eyeY - eyeHeight/2 + eyeHeight/4 - 1; y <= eyeY + eyeHeight/2 + 1; y++) { 
-      float dx = (float)(x - leftEyeX) / (eyeWidth / 2.0f);
-      float dy = (float)(y - eyeY) / (eyeHeight / 2.0f);
-      float distSquared = dx*dx + dy*dy;
-      
-      if (distSquared <= 1.0f && y >= eyeY - eyeHeight/2 + eyeHeight/4) { 
-        u8g2.drawPixel(x, y);
-      }
-      // Anti-aliasing for edges
-      else if (distSquared <= 1.2f && distSquared > 0.9f && y >= eyeY - eyeHeight/2 + eyeHeight/4) {
-        u8g2.drawPixel(x, y);
-      }
+// Parabola through the corners (±half, depth) and the top at (0, 0)
+void drawSadMouth(int mouthX, int mouthY) {
+  const int half = layout[SAD_MOUTH_HALF];
+  const int depth = layout[SAD_MOUTH_DEPTH];
+  drawStrokeQuad(mouthX - half, mouthY + depth, mouthX, mouthY - depth, mouthX + half, mouthY + depth,
+                 layout[STROKE_BOLD]);
+}
+
+// Oval eye with its top cut off at 'cutY' (inclusive), for drowsy lids.
+// In gray the cut-off part is drawn at 'lidInk' (0 leaves it blank).
+void drawLiddedEye(int centerX, int centerY, int eyeWidth, int eyeHeight, int cutY, uint8_t lidInk) {
+  if (grayscale) {
+    if (lidInk) {
+      grayInk = lidInk;
+      grayFillEllipse(centerX * 16 + 8, centerY * 16 + 8, eyeWidth * 8 + 8, eyeHeight * 8 + 8, 0, cutY * 16);
+      grayInk = 15;
     }
+    grayFillEllipse(centerX * 16 + 8, centerY * 16 + 8, eyeWidth * 8 + 8, eyeHeight * 8 + 8,
+                    cutY * 16, grayHeight * 16);
+    return;
   }
 
-  // Draw right eye (1/4th closed) with smoother edges
-  for (int x = rightEyeX - eyeWidth/2 - 1; x <= rightEyeX + eyeWidth/2 + 1; x++) {
-    for (int y = eyeY - eyeHeight/2 + eyeHeight/4 - 1; y <= eyeY + eyeHeight/2 + 1; y++) { 
-      float dx = (float)(x - rightEyeX) / (eyeWidth / 2.0f);
-      float dy = (float)(y - eyeY) / (eyeHeight / 2.0f);
+  for (int x = centerX - eyeWidth/2 - 1; x <= centerX + eyeWidth/2 + 1; x++) {
+    for (int y = cutY; y <= centerY + eyeHeight/2 + 1; y++) { 
+      float dx = (float)(x - centerX) / (eyeWidth / 2.0f);
+      float dy = (float)(y - centerY) / (eyeHeight / 2.0f);
       float distSquared = dx*dx + dy*dy;
       
-      if (distSquared <= 1.0f && y >= eyeY - eyeHeight/2 + eyeHeight/4) {
-        u8g2.drawPixel(x, y);
-      }
-      // Anti-aliasing for edges
-      else if (distSquared <= 1.2f && distSquared > 0.9f && y >= eyeY - eyeHeight/2 + eyeHeight/4) {
-        u8g2.drawPixel(x, y);
+      // Inside, plus a thin anti-aliasing ring for the edges
+      if (distSquared <= 1.2f) {
+        plotPixel(x, y);
       }
     }
   }
+}
 
-  // Draw neutral mouth - flat line with offset and anti-aliasing
-  for (int x = -10; x <= 10; x++) { 
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY);
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + 1); // slight thickness
-    
-    // Anti-aliasing at the ends
-    if (abs(x) >= 8) {
-      u8g2.drawPixel(64 + x + mouthOffsetX, mouthY - 1);
-    }
-  }
+void drawNeutralEyes() {
+  // Improved eye parameters with more spacing
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_Y] + face.eyeOffsetY;
+  const int eyeWidth = layout[EYE_WIDTH];
+  const int eyeHeight = layout[EYE_HEIGHT];
+  const int mouthY = layout[MOUTH_Y] + face.mouthOffsetY;
+
+  // Draw both eyes (1/4th closed) with smoother edges
+  drawLiddedEye(leftEyeX, eyeY, eyeWidth, eyeHeight, eyeY - eyeHeight/2 + eyeHeight/4, 0);
+  drawLiddedEye(rightEyeX, eyeY, eyeWidth, eyeHeight, eyeY - eyeHeight/2 + eyeHeight/4, 0);
+
+  // Draw neutral mouth - flat line with offset
+  const int mouthX = layout[FACE_CENTER_X] + face.mouthOffsetX;
+  drawStrokeLine(mouthX - layout[MOUTH_HALF], mouthY, mouthX + layout[MOUTH_HALF], mouthY, layout[STROKE_BOLD]);
 }
 
 void drawSleepyEyes() {
   // Eye parameters with slight adjustments for sleepy look
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 24 + eyeOffsetY;
-  const int eyeWidth = 14;
-  const int eyeHeight = 20;
-  const int mouthY = 54 + mouthOffsetY;
-
-  // Draw left eye (3/4 closed) with smoother edges
-  for (int x = leftEyeX - eyeWidth/2 - 1; x <= leftEyeX + eyeWidth/2 + 1; x++) {
-    for (int y = eyeY - eyeHeight/2 + 3*eyeHeight/4 - 1; y <= eyeY + eyeHeight/2 + 1; y++) { 
-      float dx = (float)(x - leftEyeX) / (eyeWidth / 2.0f);
-      float dy = (float)(y - eyeY) / (eyeHeight / 2.0f);
-      float distSquared = dx*dx + dy*dy;
-      
-      if (distSquared <= 1.0f && y >= eyeY - eyeHeight/2 + 3*eyeHeight/4) { 
-        u8g2.drawPixel(x, y);
-      }
-      // Anti-aliasing for edges
-      else if (distSquared <= 1.2f && distSquared > 0.9f && y >= eyeY - eyeHeight/2 + 3*eyeHeight/4) {
-        u8g2.drawPixel(x, y);
-      }
-    }
-  }
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_Y] + face.eyeOffsetY;
+  const int eyeWidth = layout[EYE_WIDTH];
+  const int eyeHeight = layout[EYE_HEIGHT];
+  const int mouthY = layout[MOUTH_LOW_Y] + face.mouthOffsetY;
 
-  // Draw right eye (3/4 closed) with smoother edges
-  for (int x = rightEyeX - eyeWidth/2 - 1; x <= rightEyeX + eyeWidth/2 + 1; x++) {
-    for (int y = eyeY - eyeHeight/2 + 3*eyeHeight/4 - 1; y <= eyeY + eyeHeight/2 + 1; y++) { 
-      float dx = (float)(x - rightEyeX) / (eyeWidth / 2.0f);
-      float dy = (float)(y - eyeY) / (eyeHeight / 2.0f);
-      float distSquared = dx*dx + dy*dy;
-      
-      if (distSquared <= 1.0f && y >= eyeY - eyeHeight/2 + 3*eyeHeight/4) {
-        u8g2.drawPixel(x, y);
-      }
-      // Anti-aliasing for edges
-      else if (distSquared <= 1.2f && distSquared > 0.9f && y >= eyeY - eyeHeight/2 + 3*eyeHeight/4) {
-        u8g2.drawPixel(x, y);
-      }
-    }
-  }
+  // Draw both eyes (3/4 closed) with smoother edges and a dim lid in gray
+  drawLiddedEye(leftEyeX, eyeY, eyeWidth, eyeHeight, eyeY - eyeHeight/2 + 3*eyeHeight/4,
+                grayLidInk);
+  drawLiddedEye(rightEyeX, eyeY, eyeWidth, eyeHeight, eyeY - eyeHeight/2 + 3*eyeHeight/4,
+                grayLidInk);
 
   // Draw slightly open mouth (small horizontal line)
-  for (int x = -7; x <= 7; x++) { 
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY);
-    // Add very slight curve downward at the ends to show relaxation
-    if (abs(x) >= 5) {
-      u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + 1);
-    }
-  }
+  const int mouthX = layout[FACE_CENTER_X] + face.mouthOffsetX;
+  const int half = layout[SLEEPY_MOUTH_HALF];
+  const int end = layout[SLEEPY_MOUTH_END];
+  const int thin = layout[STROKE_THIN];
+  drawStrokeLine(mouthX - half, mouthY, mouthX + half, mouthY, thin);
+  // Add very slight curve downward at the ends to show relaxation
+  drawStrokeLine(mouthX - half, mouthY + thin, mouthX - end, mouthY + thin, thin);
+  drawStrokeLine(mouthX + end, mouthY + thin, mouthX + half, mouthY + thin, thin);
 }
 
 void drawSleepBubble(int centerX, int centerY) {
+  PROFILE_BEGIN(PHASE_BUBBLE);
   // Parameters for bubble sequence - REDUCED SIZE
-  const int numBubbles = 3;
-  int baseBubbleSizes[numBubbles] = {2, 3, 5}; // Smaller bubbles
+  const int16_t *baseBubbleSizes = &layout[BUBBLE_SIZE_0]; // Smaller bubbles
   // Reposition bubbles more to the side and higher
-  int xOffsets[numBubbles] = {2, 8, 16};
-  int yOffsets[numBubbles] = {-2, -5, -10}; // Higher position
+  const int16_t *xOffsets = &layout[BUBBLE_DX_0];
+  const int16_t *yOffsets = &layout[BUBBLE_DY_0]; // Higher position
+  const int zSize = layout[Z_SIZE];
   
   // Draw Z character (smaller and repositioned)
-  int zX = centerX + xOffsets[2] + 4;
-  int zY = centerY + yOffsets[2] - 4;
+  int zX = centerX + xOffsets[2] + zSize;
+  int zY = centerY + yOffsets[2] - zSize;
   
   // Apply subtle movement to Z
-  float zOffset = sin(sleepBubblePhase * 0.5) * 0.8;
+  float zOffset = sin(sleepPhaseRadians() * 0.5) * 0.8;
   zY += zOffset;
   
-  // Draw top horizontal of Z (smaller)
-  for (int i = 0; i < 4; i++) {
-    u8g2.drawPixel(zX + i, zY);
-  }
-  
-  // Draw diagonal of Z (smaller)
-  for (int i = 0; i < 4; i++) {
-    u8g2.drawPixel(zX + 3 - i, zY + i);
-  }
-  
-  // Draw bottom horizontal of Z (smaller)
-  for (int i = 0; i < 4; i++) {
-    u8g2.drawPixel(zX + i, zY + 3);
-  }
+  // Top horizontal, diagonal and bottom horizontal of the Z
+  drawStrokeLine(zX, zY, zX + zSize - 1, zY, 1);
+  drawStrokeLine(zX + zSize - 1, zY, zX, zY + zSize - 1, 1);
+  drawStrokeLine(zX, zY + zSize - 1, zX + zSize - 1, zY + zSize - 1, 1);
   
   // Draw bubbles with appearance/disappearance cycle
-  for (int b = 0; b < numBubbles; b++) {
+  for (int b = 0; b < bubbleCount; b++) {
     // Calculate lifecycle phase for this bubble (0.0 - 6.28)
     updateBubbleLifecycle(b);
     
     // Only draw bubble if it's active
-    if (bubbleActive[b]) {
+    if (face.bubbleActive & (1 << b)) {
       // Calculate size based on lifecycle
       // Start small -> grow -> stay -> shrink -> disappear
-      float lifeCycleProgress = bubbleLifecycles[b] / MAX_LIFECYCLE;
+      float lifeCycleProgress = face.bubbleLifecycles[b] * 0.1f / MAX_LIFECYCLE;
       
       // Size curve: start at 0, peak at 50%, end at 0
       float sizeMultiplier;
@@ -511,360 +2404,332 @@ void drawSleepBubble(int centerX, int centerY) {
       
       // Calculate position with vertical movement
       int bubbleX = centerX + xOffsets[b];
-      // Add rising effect (bubbles rise more as they age)
-      int bubbleY = centerY + yOffsets[b] - (lifeCycleProgress * 2.5f);
+      // Add rising effect (bubbles rise more as they age; the table holds twice the rise)
+      int bubbleY = centerY + yOffsets[b] - (lifeCycleProgress * layout[BUBBLE_RISE_X2] / 2.0f);
       
       // Draw bubble with anti-aliasing
+      if (grayscale) {
+        // Fade in and out as well as grow and shrink
+        grayInk = min(15, max(3, (int)(sizeMultiplier * 15.0f)));
+        grayFillEllipse(bubbleX * 16 + 8, bubbleY * 16 + 8, radius * 16 + 8, radius * 16 + 8, 0, grayHeight * 16);
+        grayInk = 15;
+        continue;
+      }
       for (int x = -radius-1; x <= radius+1; x++) {
         for (int y = -radius-1; y <= radius+1; y++) {
           float distance = sqrt(x*x + y*y);
           
           if (distance <= radius) {
-            u8g2.drawPixel(bubbleX + x, bubbleY + y);
+            plotPixel(bubbleX + x, bubbleY + y);
           }
           // Anti-aliasing for edges
           else if (distance <= radius + 1.0f && distance > radius) {
             // Only draw some pixels for anti-aliasing effect
             if ((x + y) % 2 == 0) {
-              u8g2.drawPixel(bubbleX + x, bubbleY + y);
+              plotPixel(bubbleX + x, bubbleY + y);
             }
           }
         }
       }
     }
   }
+  PROFILE_END(PHASE_BUBBLE);
 }
 
 // Update individual bubble lifecycle
 void updateBubbleLifecycle(int bubbleIndex) {
   // Progress the lifecycle
-  bubbleLifecycles[bubbleIndex] += 0.1f;
+  face.bubbleLifecycles[bubbleIndex]++;
   
   // Reset lifecycle when complete
-  if (bubbleLifecycles[bubbleIndex] >= MAX_LIFECYCLE) {
-    bubbleLifecycles[bubbleIndex] = 0.0f;
+  if (face.bubbleLifecycles[bubbleIndex] >= bubbleLifecycleSteps) {
+    face.bubbleLifecycles[bubbleIndex] = 0;
     
     // Random chance to activate/deactivate bubble
-    bubbleActive[bubbleIndex] = (random(100) < 80); // 80% chance of being active
+    if (faceRandom(100) < 80) { // 80% chance of being active
+      face.bubbleActive |= 1 << bubbleIndex;
+    } else {
+      face.bubbleActive &= ~(1 << bubbleIndex);
+    }
   }
 }
 
 void updateSleepBubblePhase() {
-  // Update main phase counter (for Z movement)
-  sleepBubblePhase += 0.05f;
-  if (sleepBubblePhase >= TWO_PI) {
-    sleepBubblePhase -= TWO_PI;
-  }
-  
-  // Make sure at least one bubble is always active
-  bool anyActive = false;
-  for (int i = 0; i < 3; i++) {
-    if (bubbleActive[i]) {
-      anyActive = true;
-      break;
-    }
-  }
+  // Update main phase counter (for Z movement); wraps at a full turn
+  face.sleepBubblePhase += sleepPhaseStep;
   
   // Force one random bubble to be active if none are
-  if (!anyActive) {
-    bubbleActive[random(3)] = true;
+  if (!face.bubbleActive) {
+    face.bubbleActive = 1 << faceRandom(bubbleCount);
   }
 }
 
+float sleepPhaseRadians() {
+  return face.sleepBubblePhase * (float)(TWO_PI / 65536.0);
+}
+
+// Mouth rise while asleep: -1 for half of each breath, else 0
+int sleepBreath() {
+  return (int)floor(sin(sleepPhaseRadians()) * 0.5);
+}
+
 void drawSleepingEyes() {
   // Eye parameters
-  const int leftEyeX = 35 ;
-  const int rightEyeX = 93 ;
-  const int eyeY = 24 ;
-  const int eyeWidth = 14;
-  const int eyeHeight = 4; // Much flatter for closed eyes
-  const int mouthY = 54 ;
-  
-  // Draw left closed eye (horizontal line with slight curve)
-  for (int x = -eyeWidth/2; x <= eyeWidth/2; x++) {
-    float xNorm = (float)x / (eyeWidth/2);
-    float curve = 2.0f * (1.0f - xNorm * xNorm); // Subtle curve
-    
-    u8g2.drawPixel(leftEyeX + x, eyeY - (int)curve);
-    u8g2.drawPixel(leftEyeX + x, eyeY - (int)curve + 1); // Thickness
-    
-    // Anti-aliasing at the edges
-    if (abs(x) >= eyeWidth/2 - 2) {
-      u8g2.drawPixel(leftEyeX + x, eyeY - (int)curve - 1);
-    }
-  }
+  const int leftEyeX = layout[LEFT_EYE_X];
+  const int rightEyeX = layout[RIGHT_EYE_X];
+  const int eyeY = layout[EYE_Y];
+  const int lidHalf = layout[LID_HALF];
+  const int lidRise = layout[LID_RISE]; // Much flatter for closed eyes
+  const int mouthY = layout[MOUTH_LOW_Y];
   
-  // Draw right closed eye (horizontal line with slight curve)
-  for (int x = -eyeWidth/2; x <= eyeWidth/2; x++) {
-    float xNorm = (float)x / (eyeWidth/2);
-    float curve = 2.0f * (1.0f - xNorm * xNorm); // Subtle curve
-    
-    u8g2.drawPixel(rightEyeX + x, eyeY - (int)curve);
-    u8g2.drawPixel(rightEyeX + x, eyeY - (int)curve + 1); // Thickness
-    
-    // Anti-aliasing at the edges
-    if (abs(x) >= eyeWidth/2 - 2) {
-      u8g2.drawPixel(rightEyeX + x, eyeY - (int)curve - 1);
-    }
-  }
+  // Draw closed eyes: shallow arcs from (±lidHalf, 0) peaking at (0, -lidRise)
+  drawStrokeQuad(leftEyeX - lidHalf, eyeY, leftEyeX, eyeY - 2 * lidRise, leftEyeX + lidHalf, eyeY,
+                 layout[STROKE_BOLD]);
+  drawStrokeQuad(rightEyeX - lidHalf, eyeY, rightEyeX, eyeY - 2 * lidRise, rightEyeX + lidHalf, eyeY,
+                 layout[STROKE_BOLD]);
 
   // Add subtle breathing movement to the mouth
-  float mouthOffset = sin(sleepBubblePhase) * 0.5;
-  int adjustedMouthY = mouthY + mouthOffset;
+  int adjustedMouthY = mouthY + sleepBreath();
   
   // Draw slightly open relaxed mouth with subtle movement
-  for (int x = -5; x <= 5; x++) { 
-    u8g2.drawPixel(64 + x + mouthOffsetX, adjustedMouthY);
-  }
+  const int mouthX = layout[FACE_CENTER_X] + face.mouthOffsetX;
+  const int half = layout[SLEEPING_MOUTH_HALF];
+  drawStrokeLine(mouthX - half, adjustedMouthY, mouthX + half, adjustedMouthY, layout[STROKE_THIN]);
   
   // Draw sleep bubble near nose (animated with disappearing/reappearing effect)
   // Moved bubble higher and more to the right to avoid covering eyes
-  drawSleepBubble(68, eyeY + 10); // Repositioned to better avoid covering eyes
+  drawSleepBubble(layout[BUBBLE_X], eyeY + layout[BUBBLE_DROP]); // Repositioned to better avoid covering eyes
 }
 
 
 
 void drawWinkEyes() {
   // Improved eye parameters with more spacing
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 28 + eyeOffsetY;
-  const int eyeWidth = 20;
-  const int eyeHeight = 12;
-  const int mouthY = 52 + mouthOffsetY;
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_LOW_Y] + face.eyeOffsetY;
+  const int mouthY = layout[MOUTH_Y] + face.mouthOffsetY;
+  const int lidHalf = layout[LID_HALF];
+  const int bold = layout[STROKE_BOLD];
   
   // Left eye winks (closed) with smooth edges
-  drawSmoothLine(leftEyeX - 7, eyeY, leftEyeX + 7, eyeY, 2.0);
+  drawStrokeLine(leftEyeX - lidHalf, eyeY, leftEyeX + lidHalf, eyeY, layout[STROKE_BOLD] + 1);
   
-  // Right eye - normal eye (slight curve)
-  for (int x = -7; x <= 7; x++) {
-    float xf = (float)x / 7.0f;
-    float y = -abs(xf) * 3.0f - 1.0f; // Slight upward curve
-    
-    // Main curve with anti-aliasing
-    u8g2.drawPixel(rightEyeX + x, eyeY + y);
-    u8g2.drawPixel(rightEyeX + x, eyeY + y + 1); // Make thicker
-    
-    // Anti-aliasing at the ends
-    if (abs(x) >= 5) {
-      u8g2.drawPixel(rightEyeX + x, eyeY + y - 1);
-    }
-  }
+  // Right eye - normal eye (slight upward V)
+  const int eyeTipY = eyeY - layout[WINK_EYE_LIFT];
+  const int eyeEndY = eyeTipY - layout[WINK_EYE_DEPTH];
+  drawStrokeLine(rightEyeX - lidHalf, eyeEndY, rightEyeX, eyeTipY, bold);
+  drawStrokeLine(rightEyeX, eyeTipY, rightEyeX + lidHalf, eyeEndY, bold);
   
-  // Draw smile mouth with smoother edges
-  for (int x = -15; x <= 15; x++) {
-    float xf = (float)x / 15.0f;
-    float y = -abs(xf/2) * 6.0f + 3.0f; // Upward curve
-    
-    // Main curve
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y);
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y + 1); // Make thicker
-    
-    // Anti-aliasing at the ends
-    if (abs(x) >= 12) {
-      u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y - 1);
-    }
-  }
+  // Draw smile mouth
+  const int mouthX = layout[FACE_CENTER_X] + face.mouthOffsetX;
+  const int half = layout[WINK_MOUTH_HALF];
+  const int depth = layout[WINK_MOUTH_DEPTH];
+  drawStrokeLine(mouthX - half, mouthY, mouthX, mouthY + depth, bold);
+  drawStrokeLine(mouthX, mouthY + depth, mouthX + half, mouthY, bold);
 }
 
 void drawAngryEyes() {
   // Eye parameters
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeTopY = 20 + eyeOffsetY;
-  const int eyeWidth = 20;
-  const int eyeHeight = 12; // Narrower eyes for anger
-  const int mouthY = 52 + mouthOffsetY;
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeTopY = layout[EYE_TOP_Y] + face.eyeOffsetY;
+  const int eyeWidth = layout[ANGRY_EYE_WIDTH];
+  const int eyeHeight = layout[ANGRY_EYE_HEIGHT]; // Narrower eyes for anger
+  const int slant = layout[EYE_SLANT];
+  const int curve = layout[ANGRY_EYE_CURVE];
+  const int mouthY = layout[MOUTH_Y] + face.mouthOffsetY;
 
   // Draw Left Eye (outer higher, inner lower) - angry with smooth edges
   for (int x = -eyeWidth/2; x <= eyeWidth/2; x++) {
-    float xf = (float)x / (eyeWidth/2.0f);
-    float slantOffset = xf * 4.0f; // outer side higher (positive slope)
-    float curveHeight = (xf * xf) * 4.0f; // Smoother curve
-    
-    for (int y = 0; y <= eyeHeight - curveHeight; y++) {
-      u8g2.drawPixel(leftEyeX + x, eyeTopY + y + slantOffset);
+    if (grayscale) {
+      // Same slant and curve in 8.8 fixed point (xf = 2x / eyeWidth)
+      int32_t top = (int32_t)eyeTopY * 256 + (int32_t)x * slant * 512 / eyeWidth;
+      int32_t curveHeight = (int32_t)x * x * curve * 1024 / (eyeWidth * eyeWidth);
+      grayColumnCoverage(leftEyeX + x, top, top + (eyeHeight + 1) * 256 - curveHeight);
+      continue;
     }
+
+    float xf = (float)x / (eyeWidth/2.0f);
+    float slantOffset = xf * slant; // outer side higher (positive slope)
+    float curveHeight = (xf * xf) * curve; // Smoother curve
+
+    int top = eyeTopY + slantOffset;
+    fillColumn(leftEyeX + x, top, top + (int)(eyeHeight - curveHeight));
     
     // Anti-aliasing for edges
     if (abs(x) >= eyeWidth/2 - 2) {
-      u8g2.drawPixel(leftEyeX + x, eyeTopY + eyeHeight - curveHeight + 1 + slantOffset);
+      plotPixel(leftEyeX + x, eyeTopY + eyeHeight - curveHeight + 1 + slantOffset);
     }
   }
 
   // Draw Right Eye (outer higher, inner lower) - angry with smooth edges
   for (int x = -eyeWidth/2; x <= eyeWidth/2; x++) {
-    float xf = (float)x / (eyeWidth/2.0f);
-    float slantOffset = -xf * 4.0f; // outer side higher (negative slope)
-    float curveHeight = (xf * xf) * 4.0f;
-    
-    for (int y = 0; y <= eyeHeight - curveHeight; y++) {
-      u8g2.drawPixel(rightEyeX + x, eyeTopY + y + slantOffset);
+    if (grayscale) {
+      // Same slant and curve in 8.8 fixed point (xf = 2x / eyeWidth)
+      int32_t top = (int32_t)eyeTopY * 256 - (int32_t)x * slant * 512 / eyeWidth;
+      int32_t curveHeight = (int32_t)x * x * curve * 1024 / (eyeWidth * eyeWidth);
+      grayColumnCoverage(rightEyeX + x, top, top + (eyeHeight + 1) * 256 - curveHeight);
+      continue;
     }
+
+    float xf = (float)x / (eyeWidth/2.0f);
+    float slantOffset = -xf * slant; // outer side higher (negative slope)
+    float curveHeight = (xf * xf) * curve;
+
+    int top = eyeTopY + slantOffset;
+    fillColumn(rightEyeX + x, top, top + (int)(eyeHeight - curveHeight));
     
     // Anti-aliasing for edges
     if (abs(x) >= eyeWidth/2 - 2) {
-      u8g2.drawPixel(rightEyeX + x, eyeTopY + eyeHeight - curveHeight + 1 + slantOffset);
+      plotPixel(rightEyeX + x, eyeTopY + eyeHeight - curveHeight + 1 + slantOffset);
     }
   }
 
   // Angry mouth - flat or slightly downward with offset
-  const int mouthWidth = 24;
-  const int mouthHeight = 6;
-  const int mouthCenterX = 64 + mouthOffsetX;
+  const int mouthWidth = layout[ANGRY_MOUTH_WIDTH];
+  const int mouthHeight = layout[ANGRY_MOUTH_HEIGHT];
+  const int mouthCenterX = layout[FACE_CENTER_X] + face.mouthOffsetX;
   const int mouthCenterY = mouthY;
 
   // Draw mouth rectangle (outline) with smoother corners
-  for (int x = -mouthWidth/2; x <= mouthWidth/2; x++) {
-    u8g2.drawPixel(mouthCenterX + x, mouthCenterY - mouthHeight/2); // top border
-    u8g2.drawPixel(mouthCenterX + x, mouthCenterY + mouthHeight/2); // bottom border
-    
-    // Smooth corners
-    if (abs(x) >= mouthWidth/2 - 2) {
-      u8g2.drawPixel(mouthCenterX + x, mouthCenterY - mouthHeight/2 - 1);
-      u8g2.drawPixel(mouthCenterX + x, mouthCenterY + mouthHeight/2 + 1);
-    }
-  }
-  
-  for (int y = -mouthHeight/2; y <= mouthHeight/2; y++) {
-    u8g2.drawPixel(mouthCenterX - mouthWidth/2, mouthCenterY + y); // left border
-    u8g2.drawPixel(mouthCenterX + mouthWidth/2, mouthCenterY + y); // right border
-    
-    // Smooth corners
-    if (abs(y) >= mouthHeight/2 - 1) {
-      u8g2.drawPixel(mouthCenterX - mouthWidth/2 - 1, mouthCenterY + y);
-      u8g2.drawPixel(mouthCenterX + mouthWidth/2 + 1, mouthCenterY + y);
-    }
-  }
+  const int left = mouthCenterX - mouthWidth/2;
+  const int right = mouthCenterX + mouthWidth/2;
+  const int top = mouthCenterY - mouthHeight/2;
+  const int bottom = mouthCenterY + mouthHeight/2;
+  drawStrokeLine(left, top, right, top, 1);
+  drawStrokeLine(left, bottom, right, bottom, 1);
+  drawStrokeLine(left, top, left, bottom, 1);
+  drawStrokeLine(right, top, right, bottom, 1);
 
-  // Draw vertical lines inside mouth for gritted teeth with smoother edges
-  for (int x = -mouthWidth/2 + 4; x < mouthWidth/2; x += 5) { 
-    for (int y = -mouthHeight/2 + 1; y < mouthHeight/2; y++) {
-      u8g2.drawPixel(mouthCenterX + x, mouthCenterY + y);
-    }
+  // Smooth corners
+  drawStrokeLine(left, top - 1, left + 2, top - 1, 1);
+  drawStrokeLine(right - 2, top - 1, right, top - 1, 1);
+  drawStrokeLine(left, bottom + 1, left + 2, bottom + 1, 1);
+  drawStrokeLine(right - 2, bottom + 1, right, bottom + 1, 1);
+  drawStrokeLine(left - 1, top, left - 1, top + 1, 1);
+  drawStrokeLine(right + 1, top, right + 1, top + 1, 1);
+  drawStrokeLine(left - 1, bottom - 1, left - 1, bottom, 1);
+  drawStrokeLine(right + 1, bottom - 1, right + 1, bottom, 1);
+
+  // Draw vertical lines inside mouth for gritted teeth
+  const int toothSpacing = layout[TOOTH_SPACING];
+  for (int x = -mouthWidth/2 + toothSpacing - 1; x < mouthWidth/2; x += toothSpacing) { 
+    drawStrokeLine(mouthCenterX + x, top + 1, mouthCenterX + x, bottom - 1, 1);
   }
 }
 
 void drawSurprisedEyes() {
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 24 + eyeOffsetY;
-  const int eyeWidth = 14;
-  const int eyeHeight = 20;
-  const int mouthY = eyeY + 30 + mouthOffsetY; 
-  const int mouthWidth = 20;
-  const int mouthHeight = 10; 
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_Y] + face.eyeOffsetY;
+  const int eyeWidth = layout[EYE_WIDTH];
+  const int eyeHeight = layout[EYE_HEIGHT];
+  const int mouthY = eyeY + layout[SURPRISED_MOUTH_DROP] + face.mouthOffsetY; 
+  const int mouthX = layout[FACE_CENTER_X] + face.mouthOffsetX;
+  const int mouthWidth = layout[SURPRISED_MOUTH_WIDTH];
+  const int mouthHeight = layout[SURPRISED_MOUTH_HEIGHT]; 
 
   // Draw smooth ovals for eyes
   drawSmoothOval(leftEyeX, eyeY, eyeWidth, eyeHeight);
   drawSmoothOval(rightEyeX, eyeY, eyeWidth, eyeHeight);
 
   // Draw a filled "reverse U" mouth with anti-aliasing
+  if (grayscale) {
+    // Upper half of an ellipse standing on the flat bottom row
+    grayFillEllipse(mouthX * 16 + 8, mouthY * 16 + 8, mouthWidth * 8 + 8, mouthHeight * 16 + 8,
+                    0, mouthY * 16 + 16);
+    return;
+  }
   for (int x = 0; x <= mouthWidth / 2; x++) {
     float normX = (float)x / (mouthWidth / 2.0f); 
     float yLimit = sqrtf(1.0f - normX * normX) * mouthHeight; // Curve for upper part
     
-    // Draw upper curved part with anti-aliasing
-    for (int y = 0; y <= yLimit; y++) {
-      u8g2.drawPixel(64 + mouthOffsetX + x, mouthY - y); // Upper curve right
-      u8g2.drawPixel(64 + mouthOffsetX - x, mouthY - y); // Upper curve left
-    }
+    // Draw upper curved part down to the flat bottom, one column per side
+    fillColumn(mouthX + x, mouthY - (int)yLimit, mouthY); // Upper curve right
+    fillColumn(mouthX - x, mouthY - (int)yLimit, mouthY); // Upper curve left
     
     // Extra pixels for smoothness at the curve's edge
     if (x > 0 && x < mouthWidth/2 - 1) {
       float edgeY = sqrtf(1.0f - normX * normX) * mouthHeight;
-      u8g2.drawPixel(64 + mouthOffsetX + x, mouthY - edgeY - 1);
-      u8g2.drawPixel(64 + mouthOffsetX - x, mouthY - edgeY - 1);
+      plotPixel(mouthX + x, mouthY - edgeY - 1);
+      plotPixel(mouthX - x, mouthY - edgeY - 1);
     }
-
-    // Draw flat bottom
-    u8g2.drawPixel(64 + mouthOffsetX + x, mouthY); // Bottom flat line
-    u8g2.drawPixel(64 + mouthOffsetX - x, mouthY);
   }
 }
 
-void drawCryingEyes(int tearFrame) {
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 24 + eyeOffsetY;
-  const int eyeWidth = 14;
-  const int eyeHeight = 20;
-  const int tearLength = 18; // Length of falling tears
-  const int mouthY = 52 + mouthOffsetY;
+void drawCryingEyes(int frame) {
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_Y] + face.eyeOffsetY;
+  const int eyeWidth = layout[EYE_WIDTH];
+  const int eyeHeight = layout[EYE_HEIGHT];
+  const int mouthY = layout[MOUTH_Y] + face.mouthOffsetY;
 
   // Draw sad eyes (similar to drawSadEyes but with tears)
   // Draw smooth ovals for eyes
   drawSmoothOval(leftEyeX, eyeY, eyeWidth, eyeHeight);
   drawSmoothOval(rightEyeX, eyeY, eyeWidth, eyeHeight);
   
-  // Draw sad mouth - same as in drawSadEyes() but with anti-aliasing
-  for (int x = -12; x <= 12; x++) { 
-    float xf = (float)x / 12.0f; // normalize
-    float y = 4.0f * (xf*xf); // upward curve (sad mouth)
-    
-    // Draw main curve with anti-aliasing
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y);
-    u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y + 1); // slight thickness
-    
-    // Add anti-aliasing at the ends
-    if (abs(x) >= 10) {
-      u8g2.drawPixel(64 + x + mouthOffsetX, mouthY + y - 1);
-    }
-  }
+  // Draw sad mouth - same as in drawSadEyes()
+  drawSadMouth(layout[FACE_CENTER_X] + face.mouthOffsetX, mouthY);
 
-  // Draw zigzag tears with animation
-  // Function to draw a tear drop with zigzag pattern
-  auto drawTear = [&](int centerX, int startY, int frame, int offset) {
-    // Calculate tear position based on animation progress
-    int tearProgress = (tearCount + offset) % tearLength;
-    
-    // Draw the entire tear track
-    for (int i = 0; i < tearLength; i++) {
-      // Only draw the tear if it's in the current position (for falling effect)
-      if (i <= tearProgress) {
-        // Create zigzag pattern
-        int zigzag = (i % 3 == 0) ? ((frame == 1) ? 1 : -1) : 0;
-        
-        // Draw tear droplet (thicker at the bottom)
-        u8g2.drawPixel(centerX + zigzag, startY + i);
-        
-        // Make tear wider at bottom for a droplet effect
-        if (i >= tearLength - 4) {
-          u8g2.drawPixel(centerX + zigzag - 1, startY + i);
-          u8g2.drawPixel(centerX + zigzag + 1, startY + i);
-        }
-        
-        // Extra thickness in middle of tear track for visibility
-        if (i >= 2 && i < tearLength - 4) {
-          // Alternating sides for zigzag effect
-          if (i % 2 == 0) {
-            u8g2.drawPixel(centerX + zigzag + 1, startY + i);
-          } else {
-            u8g2.drawPixel(centerX + zigzag - 1, startY + i);
-          }
+  // Draw tears from both eyes
+  drawTear(leftEyeX, eyeY + eyeHeight/2, frame, 0);
+  drawTear(rightEyeX, eyeY + eyeHeight/2, !frame, 2); // Slight offset for right eye tear
+}
+
+// Draw a tear drop with a zigzag pattern, falling with face.tearCount
+void drawTear(int centerX, int startY, int frame, int offset) {
+  const int tearLength = layout[TEAR_LENGTH];
+
+  // Calculate tear position based on animation progress
+  int tearProgress = (face.tearCount + offset) % tearLength;
+  
+  // Draw the entire tear track
+  for (int i = 0; i < tearLength; i++) {
+    // Only draw the tear if it's in the current position (for falling effect)
+    if (i <= tearProgress) {
+      // Create zigzag pattern
+      int zigzag = (i % 3 == 0) ? ((frame == 1) ? 1 : -1) : 0;
+      
+      // Draw tear droplet (thicker at the bottom)
+      plotPixel(centerX + zigzag, startY + i);
+      
+      // Make tear wider at bottom for a droplet effect
+      if (i >= tearLength - 4) {
+        plotPixel(centerX + zigzag - 1, startY + i);
+        plotPixel(centerX + zigzag + 1, startY + i);
+      }
+      
+      // Extra thickness in middle of tear track for visibility
+      if (i >= 2 && i < tearLength - 4) {
+        // Alternating sides for zigzag effect
+        if (i % 2 == 0) {
+          plotPixel(centerX + zigzag + 1, startY + i);
+        } else {
+          plotPixel(centerX + zigzag - 1, startY + i);
         }
       }
     }
-  };
-
-  // Draw tears from both eyes
-  drawTear(leftEyeX, eyeY + eyeHeight/2, tearFrame, 0);
-  drawTear(rightEyeX, eyeY + eyeHeight/2, !tearFrame, 2); // Slight offset for right eye tear
+  }
 }
 
 void drawBlinkingEyes() {
   // Improved eye parameters with more spacing
-  const int leftEyeX = 35 + eyeOffsetX;
-  const int rightEyeX = 93 + eyeOffsetX;
-  const int eyeY = 28 + eyeOffsetY;
+  const int leftEyeX = layout[LEFT_EYE_X] + face.eyeOffsetX;
+  const int rightEyeX = layout[RIGHT_EYE_X] + face.eyeOffsetX;
+  const int eyeY = layout[EYE_LOW_Y] + face.eyeOffsetY;
+  const int lidHalf = layout[LID_HALF];
+  const int width = layout[STROKE_BOLD] + 1;
   
-  // Draw closed eyes - just horizontal lines with anti-aliasing
-  drawSmoothLine(leftEyeX - 7, eyeY, leftEyeX + 7, eyeY, 2.0);
-  drawSmoothLine(rightEyeX - 7, eyeY, rightEyeX + 7, eyeY, 2.0);
+  // Draw closed eyes - just horizontal lines
+  drawStrokeLine(leftEyeX - lidHalf, eyeY, leftEyeX + lidHalf, eyeY, width);
+  drawStrokeLine(rightEyeX - lidHalf, eyeY, rightEyeX + lidHalf, eyeY, width);
 }
 
 // Helper function for drawing thick circles with anti-aliasing
-void drawSmoothThickCircle(int x0, int y0, int radius, float thickness = 1.0) {
+void drawSmoothThickCircle(int x0, int y0, int radius, float thickness) {
   // Draw outer and inner circles for thickness
   for (int angle = 0; angle < 360; angle++) {
     float radians = angle * PI / 180.0;
@@ -872,44 +2737,24 @@ void drawSmoothThickCircle(int x0, int y0, int radius, float thickness = 1.0) {
     float y = sin(radians) * radius;
     
     // Draw main circle
-    u8g2.drawPixel(x0 + x, y0 + y);
+    plotPixel(x0 + x, y0 + y);
 	 if (thickness > 1.0) {
       // Inner thickness
       float innerRadius = radius - 0.7;
       x = cos(radians) * innerRadius;
       y = sin(radians) * innerRadius;
-      u8g2.drawPixel(x0 + x, y0 + y);
+      plotPixel(x0 + x, y0 + y);
       
       // Outer thickness
       float outerRadius = radius + 0.7;
       x = cos(radians) * outerRadius;
       y = sin(radians) * outerRadius;
-      u8g2.drawPixel(x0 + x, y0 + y);
+      plotPixel(x0 + x, y0 + y);
     }
   }
 }
 
-// Helper function for drawing thick lines with anti-aliasing
+// Helper function for drawing thick lines
 void drawThickLine(int x0, int y0, int x1, int y1) {
-  // Draw main line
-  u8g2.drawLine(x0, y0, x1, y1);
-  
-  // Make the line thicker by drawing additional lines with anti-aliasing
-  if (x0 == x1) {
-    // Vertical line, thicken horizontally
-    u8g2.drawLine(x0 - 1, y0, x1 - 1, y1);
-    u8g2.drawLine(x0 + 1, y0, x1 + 1, y1);
-  } else if (y0 == y1) {
-    // Horizontal line, thicken vertically
-    u8g2.drawLine(x0, y0 - 1, x1, y1 - 1);
-    u8g2.drawLine(x0, y0 + 1, x1, y1 + 1);
-  } else {
-    // Diagonal line, thicken in both directions
-    u8g2.drawLine(x0 + 1, y0, x1 + 1, y1);
-    u8g2.drawLine(x0, y0 + 1, x1, y1 + 1);
-    
-    // Add anti-aliasing at endpoints
-    u8g2.drawPixel(x0 - 1, y0);
-    u8g2.drawPixel(x1 + 1, y1);
-  }
+  drawStrokeLine(x0, y0, x1, y1, 3);
 }